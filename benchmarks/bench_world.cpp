@@ -0,0 +1,286 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Frame stepping benchmark, scenes are built like examples/horde.py but scaled up.
+// Outputs one JSON object per scene on stdout.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "body.hpp"
+#include "circle.hpp"
+#include "massshape.hpp"
+#include "polygon.hpp"
+#include "sensor.hpp"
+#include "utils.hpp"
+#include "world.hpp"
+
+using namespace std;
+using namespace shyphe;
+
+const double SHAPE_SIZE = 50;
+const double SPACING = 100;
+
+struct BenchOptions {
+    vector<unsigned int> bodies = {100, 1000, 10000};
+    unsigned int frames = 10;
+    unsigned int seed = 0;
+    double frame_time = 1;
+    bool sensors = false;
+    string broadphase = "sat_axes";
+    unsigned int threads = 1;
+    string toi = "conservative";
+    double spin = 0;
+};
+
+const vector<pair<string, BroadphaseType>> BROADPHASES = {
+    {"sat_axes", BroadphaseType::sat_axes},
+    {"aabb_tree", BroadphaseType::aabb_tree},
+    {"spatial_hash", BroadphaseType::spatial_hash}
+};
+
+const vector<pair<string, TOISolver>> TOI_SOLVERS = {
+    {"conservative", TOISolver::conservative},
+    {"bilateral", TOISolver::bilateral}
+};
+
+TOISolver toi_solver(const string& name) {
+    for (const auto& solver : TOI_SOLVERS) {
+        if (solver.first == name) {
+            return solver.second;
+        }
+    }
+    throw invalid_argument("Unknown TOI solver " + name);
+}
+
+BroadphaseType broadphase_type(const string& name) {
+    for (const auto& bp : BROADPHASES) {
+        if (bp.first == name) {
+            return bp.second;
+        }
+    }
+    throw invalid_argument("Unknown broadphase " + name);
+}
+
+struct BenchResult {
+    unsigned int bodies = 0;
+    unsigned int frames = 0;
+    unsigned long collisions = 0;
+    double begin_frame = 0;
+    double collision_loop = 0;
+    double end_frame = 0;
+    TOIStats toi_stats;
+};
+
+typedef chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+void print_usage(const char* name) {
+    cerr << "Usage: " << name << " [--bodies N[,N...]] [--frames F] [--seed S] [--frame-time T] [--sensors]"
+         << " [--broadphase sat_axes|aabb_tree|spatial_hash] [--threads N] [--toi conservative|bilateral]"
+         << " [--spin W]" << endl;
+}
+
+vector<unsigned int> parse_list(const string& str) {
+    vector<unsigned int> res;
+    stringstream ss(str);
+    string item;
+    while (getline(ss, item, ',')) {
+        res.push_back(stoul(item));
+    }
+    return res;
+}
+
+bool parse_args(int argc, char** argv, BenchOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--sensors") {
+            opts.sensors = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            return false;
+        }
+        string value = argv[++i];
+        if (arg == "--bodies") {
+            opts.bodies = parse_list(value);
+        }
+        else if (arg == "--frames") {
+            opts.frames = stoul(value);
+        }
+        else if (arg == "--seed") {
+            opts.seed = stoul(value);
+        }
+        else if (arg == "--frame-time") {
+            opts.frame_time = stod(value);
+        }
+        else if (arg == "--broadphase") {
+            broadphase_type(value);
+            opts.broadphase = value;
+        }
+        else if (arg == "--threads") {
+            opts.threads = stoul(value);
+        }
+        else if (arg == "--toi") {
+            toi_solver(value);
+            opts.toi = value;
+        }
+        else if (arg == "--spin") {
+            opts.spin = stod(value);
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+double build_scene(World& world, unsigned int number_of_bodies, const BenchOptions& opts) {
+    mt19937 rng(opts.seed);
+    uniform_int_distribution<int> vel(-20, 20), kind(0, 1);
+    uniform_real_distribution<double> spin(-opts.spin, opts.spin);
+    unsigned int per_row = ceil(sqrt(number_of_bodies));
+    auto hs = SHAPE_SIZE / 2;
+
+    for (unsigned int i = 0; i < number_of_bodies; ++i) {
+        auto vx = vel(rng), vy = vel(rng);
+        auto angular_velocity = opts.spin ? spin(rng) : 0;
+        auto body = make_shared<Body>(Vec{SPACING * (i % per_row), SPACING * (i / per_row)}, Vec(vx, vy), 0, angular_velocity);
+        if (kind(rng)) {
+            body->addShape(make_shared<Circle>(hs, 1));
+        }
+        else {
+            body->addShape(make_shared<Polygon>(vector<Vec>{{-hs, -hs}, {-hs, hs}, {hs, hs}, {hs, -hs}}, 1));
+        }
+        if (opts.sensors) {
+            body->addShape(make_shared<MassShape>(0, 0, Vec{}, 10, 10, 10));
+            body->addSensor(make_shared<ActiveRadar>(SPACING * 4, 1));
+        }
+        world.addBody(body);
+    }
+    return SPACING * per_row;
+}
+
+void bounce_off_walls(World& world, double size) {
+    // Same as the walls in examples/horde.py
+    for (const auto& body : world.bodies()) {
+        auto pos = body->position(), vel = body->velocity();
+        if ((pos.x < 0 && vel.x < 0) || (pos.x > size && vel.x > 0)) {
+            body->applyImpulse({2 * -vel.x * body->mass(), 0}, {0, 0});
+        }
+        if ((pos.y < 0 && vel.y < 0) || (pos.y > size && vel.y > 0)) {
+            body->applyImpulse({0, 2 * -vel.y * body->mass()}, {0, 0});
+        }
+    }
+}
+
+BenchResult run_scene(unsigned int number_of_bodies, const BenchOptions& opts) {
+    World world(opts.frame_time, broadphase_type(opts.broadphase));
+    world.setThreads(opts.threads);
+    world.setTOISolver(toi_solver(opts.toi));
+    auto size = build_scene(world, number_of_bodies, opts);
+    auto params = CollisionParameters(1);
+    BenchResult res;
+    res.bodies = number_of_bodies;
+    res.frames = opts.frames;
+
+    for (unsigned int frame = 0; frame < opts.frames; ++frame) {
+        bounce_off_walls(world, size);
+
+        auto start = Clock::now();
+        world.beginFrame();
+        res.begin_frame += seconds_since(start);
+
+        start = Clock::now();
+        while (world.hasNextCollision()) {
+            auto col = world.nextCollision();
+            auto resolved = world.calculateCollision(col, params);
+            resolved.first.apply_impulse();
+            resolved.second.apply_impulse();
+            world.finishedCollision(col, true);
+            ++res.collisions;
+        }
+        res.collision_loop += seconds_since(start);
+        const auto& stats = world.toiStats();
+        res.toi_stats.pairs += stats.pairs;
+        res.toi_stats.iterations += stats.iterations;
+        res.toi_stats.max_iterations = max(res.toi_stats.max_iterations, stats.max_iterations);
+        res.toi_stats.culled += stats.culled;
+
+        start = Clock::now();
+        world.endFrame();
+        res.end_frame += seconds_since(start);
+    }
+    return res;
+}
+
+void print_result(const BenchResult& res, const BenchOptions& opts) {
+    cout << "{\"version\": \"" << version() << "\""
+         << ", \"bodies\": " << res.bodies
+         << ", \"frames\": " << res.frames
+         << ", \"sensors\": " << (opts.sensors ? "true" : "false")
+         << ", \"broadphase\": \"" << opts.broadphase << "\""
+         << ", \"threads\": " << opts.threads
+         << ", \"seed\": " << opts.seed
+         << ", \"toi\": \"" << opts.toi << "\""
+         << ", \"spin\": " << opts.spin
+         << ", \"collisions\": " << res.collisions
+         << ", \"toi_pairs\": " << res.toi_stats.pairs
+         << ", \"toi_iterations\": " << res.toi_stats.iterations
+         << ", \"toi_max_iterations\": " << res.toi_stats.max_iterations
+         << ", \"culled_shape_pairs\": " << res.toi_stats.culled
+         << ", \"begin_frame_s\": " << res.begin_frame
+         << ", \"collision_loop_s\": " << res.collision_loop
+         << ", \"end_frame_s\": " << res.end_frame
+         << ", \"total_s\": " << res.begin_frame + res.collision_loop + res.end_frame
+         << "}" << endl;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opts;
+    try {
+        if (!parse_args(argc, argv, opts)) {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    catch (const logic_error&) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    cout.precision(9);
+    for (auto number_of_bodies : opts.bodies) {
+        print_result(run_scene(number_of_bodies, opts), opts);
+    }
+    return 0;
+}
@@ -35,17 +35,10 @@ while window.active():
         if body.position.y < 0 and body.velocity.y < 0 or body.position.y > window.height and body.velocity.y > 0:
             body.apply_impulse((0, 2 * -body.velocity.y * body.mass), (0, 0))
 
-    colliding = []
-    world.begin_frame()
-    while world.has_next_collision():
-        ctr = world.next_collision()
-        cola, colb = world.calculate_collision(ctr, shyphe.CollisionParameters(1))
-        cola.apply_impulse()
-        colb.apply_impulse()
-        colliding.extend((cola.body, colb.body))
-        world.finished_collision(ctr, True)
-    world.end_frame()
+    events = world.step(shyphe.CollisionParameters(1)).tolist()
+    # Each event starts with the indexes of its two bodies
+    colliding = set(events[0::9]) | set(events[1::9])
 
-    for body in world.bodies:
-        draw_shape.draw_body(window, body, "red" if body in colliding else "green")
+    for i, body in enumerate(world.bodies):
+        draw_shape.draw_body(window, body, "red" if i in colliding else "green")
     window.update()
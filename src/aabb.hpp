@@ -58,6 +58,18 @@ namespace shyphe {
             max_y += other.y;
         }
 
+        inline bool overlaps(const AABB& other) const {
+            return min_x <= other.max_x && other.min_x <= max_x && min_y <= other.max_y && other.min_y <= max_y;
+        }
+
+        inline bool contains(const AABB& other) const {
+            return min_x <= other.min_x && other.max_x <= max_x && min_y <= other.min_y && other.max_y <= max_y;
+        }
+
+        inline double perimeter() const {
+            return 2 * (max_x - min_x + max_y - min_y);
+        }
+
         inline Vec bottomleft() const {
             return {min_x, min_y};
         }
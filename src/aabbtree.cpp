@@ -0,0 +1,301 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "aabbtree.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace shyphe;
+
+AABBTree::AABBTree(double margin_/*=0.1*/) : margin(margin_) {
+}
+
+AABB AABBTree::_fatten(const AABB& aabb, const Vec& displacement) const {
+    // Extend in the direction of travel as well, so a body coasting at the same speed keeps the same leaf next frame
+    auto fat = aabb & (aabb + displacement);
+    auto grow = margin * max(aabb.max_x - aabb.min_x, aabb.max_y - aabb.min_y);
+    return {fat.min_x - grow, fat.max_x + grow, fat.min_y - grow, fat.max_y + grow};
+}
+
+void AABBTree::updateBody(Body* body, double time) {
+    auto aabb = body->position() + body->aabb(time);
+    auto fat = _fatten(aabb, body->velocity() * time);
+
+    auto iter = body_proxies.find(body);
+    if (iter == body_proxies.end()) {
+        unsigned int proxy_index;
+        if (free_proxies.size()) {
+            proxy_index = free_proxies.back();
+            free_proxies.pop_back();
+            proxies[proxy_index].body = body;
+            proxies[proxy_index].aabb = aabb;
+        }
+        else {
+            proxy_index = proxies.size();
+            proxies.push_back({body, aabb, -1, {}});
+        }
+        body_proxies[body] = proxy_index;
+
+        auto leaf = _allocateNode();
+        nodes[leaf] = {fat, -1, -1, -1, 0, proxy_index};
+        proxies[proxy_index].leaf = leaf;
+        _insertLeaf(leaf);
+        _updateOverlaps(proxy_index);
+        return;
+    }
+
+    auto& proxy = proxies[iter->second];
+    proxy.aabb = aabb;
+    if (nodes[proxy.leaf].aabb.contains(aabb)) {
+        return;
+    }
+    _removeLeaf(proxy.leaf);
+    nodes[proxy.leaf].aabb = fat;
+    _insertLeaf(proxy.leaf);
+    _updateOverlaps(iter->second);
+}
+
+void AABBTree::removeBody(Body* body) {
+    auto iter = body_proxies.find(body);
+    if (iter == body_proxies.end()) {
+        return;
+    }
+    auto proxy_index = iter->second;
+    _clearOverlaps(proxy_index);
+    auto leaf = proxies[proxy_index].leaf;
+    _removeLeaf(leaf);
+    nodes[leaf].height = -1;
+    free_nodes.push_back(leaf);
+
+    proxies[proxy_index].body = nullptr;
+    free_proxies.push_back(proxy_index);
+    body_proxies.erase(iter);
+}
+
+int AABBTree::_allocateNode() {
+    if (free_nodes.size()) {
+        auto node = free_nodes.back();
+        free_nodes.pop_back();
+        return node;
+    }
+    nodes.push_back({{0, 0, 0, 0}, -1, -1, -1, 0, 0});
+    return nodes.size() - 1;
+}
+
+void AABBTree::_insertLeaf(int leaf) {
+    if (root == -1) {
+        root = leaf;
+        nodes[leaf].parent = -1;
+        return;
+    }
+
+    // Walk down choosing the cheapest sibling by perimeter, as in Box2D's b2DynamicTree
+    auto leaf_aabb = nodes[leaf].aabb;
+    auto index = root;
+    while (nodes[index].height > 0) {
+        auto left = nodes[index].left, right = nodes[index].right;
+        auto perimeter = nodes[index].aabb.perimeter();
+        auto combined = (nodes[index].aabb & leaf_aabb).perimeter();
+        auto cost = 2 * combined;
+        auto inheritance = 2 * (combined - perimeter);
+
+        auto child_cost = [this, &leaf_aabb, inheritance](int child) {
+            auto c = (nodes[child].aabb & leaf_aabb).perimeter();
+            return (nodes[child].height ? c - nodes[child].aabb.perimeter() : c) + inheritance;
+        };
+        auto left_cost = child_cost(left), right_cost = child_cost(right);
+
+        if (cost < left_cost && cost < right_cost) {
+            break;
+        }
+        index = left_cost < right_cost ? left : right;
+    }
+
+    auto sibling = index;
+    auto old_parent = nodes[sibling].parent;
+    auto new_parent = _allocateNode();
+    nodes[new_parent] = {leaf_aabb & nodes[sibling].aabb, old_parent, sibling, leaf, nodes[sibling].height + 1, 0};
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if (old_parent == -1) {
+        root = new_parent;
+    }
+    else if (nodes[old_parent].left == sibling) {
+        nodes[old_parent].left = new_parent;
+    }
+    else {
+        nodes[old_parent].right = new_parent;
+    }
+
+    _refit(new_parent);
+}
+
+void AABBTree::_removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = -1;
+        return;
+    }
+
+    auto parent = nodes[leaf].parent;
+    auto grandparent = nodes[parent].parent;
+    auto sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    nodes[parent].height = -1;
+    free_nodes.push_back(parent);
+    nodes[sibling].parent = grandparent;
+
+    if (grandparent == -1) {
+        root = sibling;
+        return;
+    }
+    if (nodes[grandparent].left == parent) {
+        nodes[grandparent].left = sibling;
+    }
+    else {
+        nodes[grandparent].right = sibling;
+    }
+    _refit(grandparent);
+}
+
+void AABBTree::_refit(int node) {
+    while (node != -1) {
+        node = _balance(node);
+        auto& n = nodes[node];
+        n.height = 1 + max(nodes[n.left].height, nodes[n.right].height);
+        n.aabb = nodes[n.left].aabb & nodes[n.right].aabb;
+        node = n.parent;
+    }
+}
+
+int AABBTree::_balance(int a) {
+    // Rotate the taller child up if the children's heights differ by more than one, returns the new subtree root
+    if (nodes[a].height < 2) {
+        return a;
+    }
+
+    auto b = nodes[a].left, c = nodes[a].right;
+    auto balance = nodes[c].height - nodes[b].height;
+    if (balance >= -1 && balance <= 1) {
+        return a;
+    }
+
+    // up is the child being rotated up, other is a's other child
+    auto up = balance > 1 ? c : b;
+    auto other = balance > 1 ? b : c;
+    auto f = nodes[up].left, g = nodes[up].right;
+
+    nodes[up].left = a;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+
+    if (nodes[up].parent == -1) {
+        root = up;
+    }
+    else if (nodes[nodes[up].parent].left == a) {
+        nodes[nodes[up].parent].left = up;
+    }
+    else {
+        nodes[nodes[up].parent].right = up;
+    }
+
+    // The taller grandchild stays under up, the shorter one moves under a in place of up
+    auto keep = nodes[f].height > nodes[g].height ? f : g;
+    auto move = keep == f ? g : f;
+    nodes[up].right = keep;
+    if (balance > 1) {
+        nodes[a].right = move;
+    }
+    else {
+        nodes[a].left = move;
+    }
+    nodes[move].parent = a;
+
+    nodes[a].aabb = nodes[other].aabb & nodes[move].aabb;
+    nodes[a].height = 1 + max(nodes[other].height, nodes[move].height);
+    nodes[up].aabb = nodes[a].aabb & nodes[keep].aabb;
+    nodes[up].height = 1 + max(nodes[a].height, nodes[keep].height);
+    return up;
+}
+
+void AABBTree::_clearOverlaps(unsigned int proxy_index) {
+    for (auto other : proxies[proxy_index].overlaps) {
+        auto& other_overlaps = proxies[other].overlaps;
+        auto iter = find(other_overlaps.begin(), other_overlaps.end(), proxy_index);
+        *iter = other_overlaps.back();
+        other_overlaps.pop_back();
+    }
+    proxies[proxy_index].overlaps.clear();
+}
+
+void AABBTree::_updateOverlaps(unsigned int proxy_index) {
+    _clearOverlaps(proxy_index);
+    const auto& fat = nodes[proxies[proxy_index].leaf].aabb;
+    vector<int> stack = {root};
+    while (stack.size()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (!nodes[node].aabb.overlaps(fat)) {
+            continue;
+        }
+        if (nodes[node].height) {
+            stack.push_back(nodes[node].left);
+            stack.push_back(nodes[node].right);
+        }
+        else if (nodes[node].proxy != proxy_index) {
+            proxies[proxy_index].overlaps.push_back(nodes[node].proxy);
+            proxies[nodes[node].proxy].overlaps.push_back(proxy_index);
+        }
+    }
+}
+
+vector<pair<Body*, Body*>> AABBTree::possibleCollisions() const {
+    auto result = vector<pair<Body*, Body*>>{};
+    for (const auto& proxy : proxies) {
+        for (auto other : proxy.overlaps) {
+            const auto& other_proxy = proxies[other];
+            if (proxy.body < other_proxy.body && proxy.aabb.overlaps(other_proxy.aabb)) {
+                result.push_back({proxy.body, other_proxy.body});
+            }
+        }
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+vector<pair<Body*, Body*>> AABBTree::possibleCollisions(const vector<Body*>& bodies) const {
+    auto result = vector<pair<Body*, Body*>>{};
+    for (auto body : bodies) {
+        auto iter = body_proxies.find(body);
+        if (iter == body_proxies.end()) {
+            continue;
+        }
+        const auto& proxy = proxies[iter->second];
+        for (auto other : proxy.overlaps) {
+            const auto& other_proxy = proxies[other];
+            if (proxy.aabb.overlaps(other_proxy.aabb)) {
+                result.push_back(body < other_proxy.body ? make_pair(body, other_proxy.body) : make_pair(other_proxy.body, body));
+            }
+        }
+    }
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+}
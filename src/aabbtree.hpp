@@ -0,0 +1,78 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_AABBTREE_HPP
+#define SHYPHE_AABBTREE_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include "aabb.hpp"
+#include "body.hpp"
+#include "broadphase.hpp"
+
+namespace shyphe {
+    struct AABBTreeNode {
+        AABB aabb;
+        int parent, left, right;
+        // Leaves have height 0
+        int height;
+        unsigned int proxy;
+    };
+
+    struct AABBTreeProxy {
+        Body* body;
+        AABB aabb;
+        int leaf;
+        // Proxies whose fat boxes overlap this one's
+        std::vector<unsigned int> overlaps;
+    };
+
+    // Dynamic bounding volume tree. Each leaf holds a fattened copy of a body's swept AABB, and the body is only
+    // reinserted (and its overlapping pairs found again) when its swept AABB leaves the fat one.
+    class AABBTree : public Broadphase {
+    public:
+        AABBTree(double margin_=0.1);
+        virtual void updateBody(Body* body, double time) override;
+        virtual void removeBody(Body* body) override;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions() const override;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions(const std::vector<Body*>& bodies) const override;
+
+        // Fraction of the largest side of the swept AABB added to each side of the fat AABB
+        double margin;
+    private:
+        std::vector<AABBTreeNode> nodes;
+        std::vector<int> free_nodes;
+        int root = -1;
+        std::vector<AABBTreeProxy> proxies;
+        std::vector<unsigned int> free_proxies;
+        std::unordered_map<Body*, unsigned int> body_proxies;
+
+        AABB _fatten(const AABB& aabb, const Vec& displacement) const;
+        int _allocateNode();
+        void _insertLeaf(int leaf);
+        void _removeLeaf(int leaf);
+        void _refit(int node);
+        int _balance(int node);
+        void _updateOverlaps(unsigned int proxy_index);
+        void _clearOverlaps(unsigned int proxy_index);
+    };
+}
+
+#endif // SHYPHE_AABBTREE_HPP
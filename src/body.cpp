@@ -21,49 +21,85 @@
 #include "utils.hpp"
 #include "shape.hpp"
 #include "sensor.hpp"
+#include "polygon.hpp"
 
 #include <algorithm>
 #include <cmath>
-#include <numeric>
+#include <limits>
 
 using namespace std;
 using namespace shyphe;
 
+// Caps the strips of one update, so a long step or high rate cannot overflow their count
+const double MAX_STRIPS = 1 << 20;
+
 Body::Body(const Vec& position_/*={}*/, const Vec& velocity_/*={}*/,
            double angle_/*=0*/, double angular_velocity_/*=0*/,
            int side_/*=0*/) : _position(position_),
                               _velocity(velocity_),
                               _angle(angle_),
                               _angular_velocity(angular_velocity_),
+                              _rot(angle_),
                               _side(side_) {
 }
 
-AABB aabbAtAngle(const vector<shared_ptr<Shape>>& shapes, double angle) {
-    auto iter = shapes.begin();
-    auto end = shapes.end();
-    AABB aabb = {0, 0, 0, 0};
-    for (; iter != end; ++iter) {
-        if ((*iter)->canCollide()) {
-            aabb = (*iter)->aabb(angle) + (*iter)->position.rotate(angle);
-            break;
+Body::~Body() {
+    for (const auto& shape : _shapes) {
+        auto& owners = shape->_owners;
+        owners.erase(remove(owners.begin(), owners.end(), this), owners.end());
+    }
+}
+
+// Andrew's monotone chain, dropping duplicate and collinear points
+static vector<Vec> convexHull(vector<Vec> points) {
+    sort(points.begin(), points.end());
+    points.erase(unique(points.begin(), points.end()), points.end());
+    if (points.size() < 3) {
+        return points;
+    }
+    vector<Vec> hull(2 * points.size());
+    size_t k = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        while (k >= 2 && (hull[k - 1] - hull[k - 2]).cross(points[i] - hull[k - 2]) <= 0) {
+            --k;
+        }
+        hull[k++] = points[i];
+    }
+    for (size_t i = points.size() - 1, lower = k + 1; i > 0; --i) {
+        while (k >= lower && (hull[k - 1] - hull[k - 2]).cross(points[i - 1] - hull[k - 2]) <= 0) {
+            --k;
         }
+        hull[k++] = points[i - 1];
     }
-    if (iter == end) {
+    hull.resize(k - 1);
+    return hull;
+}
+
+AABB Body::_aabbAtAngle(const Rot& rot) const {
+    if (_hull.empty() && _bounded_shapes.empty()) {
         return {0, 0, 0, 0};
     }
-    for (; iter != end; ++iter) {
-        if ((*iter)->canCollide()) {
-            aabb &= (*iter)->aabb(angle) + (*iter)->position.rotate(angle);
-        }
+    auto inf = numeric_limits<double>::infinity();
+    AABB aabb = {inf, -inf, inf, -inf};
+    for (const auto& point : _hull) {
+        auto rpoint = point.rotate(rot);
+        aabb &= {rpoint.x, rpoint.x, rpoint.y, rpoint.y};
+    }
+    for (auto shape : _bounded_shapes) {
+        aabb &= shape->aabb(rot) + shape->position.rotate(rot);
     }
     return aabb;
 }
 
 AABB Body::aabb(double time) const {
-    AABB aabb = aabbAtAngle(_shapes, _angle);
+    if (_start_aabb_angle != _angle) {
+        _start_aabb = _aabbAtAngle(_rot);
+        _start_aabb_angle = _angle;
+    }
+    AABB aabb = _start_aabb;
     if (_angular_velocity) {
         auto end_angle = _angle + _angular_velocity * time;
-        aabb &= aabbAtAngle(_shapes, end_angle);
+        aabb &= _aabbAtAngle(Rot(end_angle));
         int extreme_start = ceil(_angle / hpi());
         int extreme_range = (end_angle - _angle) / hpi();
         int extreme_end;
@@ -75,8 +111,10 @@ AABB Body::aabb(double time) const {
             extreme_end = extreme_start + floor(abs(extreme_range));
         }
 
+        // The extremes repeat every full turn, so at most four are needed
+        extreme_end = min(extreme_end, extreme_start + 3);
         for (; extreme_start <= extreme_end; ++extreme_start) {
-            aabb &= aabbAtAngle(_shapes, extreme_start * hpi());
+            aabb &= _quadrant_aabbs[(extreme_start % 4 + 4) % 4];
         }
     }
     return aabb & (aabb + _velocity * time);
@@ -92,19 +130,34 @@ Signature Body::signature() {
     return sig;
 }
 
-double Body::mass() const {
-    return accumulate(_shapes.begin(), _shapes.end(), 0.0, [](double acc, const shared_ptr<Shape>& shape){return acc + shape->mass;});
-}
-
-double Body::momentOfInertia() const {
-    double moi = 0;
-    for (const auto& shape : _shapes) {
-        moi += shape->momentOfInertia() + shape->mass * shape->position.squared();
+static void integrateSpinningForce(const Vec& force, const Rot& rot, double angle_change, Vec& vel_accumulator, Vec& pos_accumulator) {
+    // Closed form of the force integrals when the body spins at a constant rate. The force at time t is
+    // start_force rotated by angle_change * t / time, and rotating by a quarter turn is the derivative.
+    auto start_force = force.rotate(rot);
+    auto quarter = Vec{start_force.y, -start_force.x};
+    double a, b, c, d;
+    if (abs(angle_change) < 1e-3) {
+        // Taylor series, as the closed forms below cancel badly for small angles
+        auto sq = angle_change * angle_change;
+        a = 1 - sq / 6 + sq * sq / 120;
+        b = angle_change / 2 - angle_change * sq / 24;
+        c = 0.5 - sq / 24 + sq * sq / 720;
+        d = angle_change / 6 - angle_change * sq / 120;
     }
-    return moi;
+    else {
+        auto half_sin = sin(angle_change / 2);
+        a = sin(angle_change) / angle_change;
+        b = 2 * half_sin * half_sin / angle_change;
+        c = b / angle_change;
+        d = (angle_change - sin(angle_change)) / (angle_change * angle_change);
+    }
+    vel_accumulator = start_force * a + quarter * b;
+    pos_accumulator = start_force * c + quarter * d;
 }
 
-void Body::update(double time) {
+static void integrateMotion(Vec& position, Vec& velocity, double& angle, Rot& rot, double& angular_velocity,
+                     const Vec& local_force, const Vec& global_force, double torque,
+                     double mass, double moment_of_inertia, double strips_per_second, double time) {
     if (!time) {
         return;
     }
@@ -112,41 +165,115 @@ void Body::update(double time) {
         throw runtime_error("time cannot be negative, use state() and reset()");
     }
 
-    auto angular_acceleration = (_local_torque + _global_torque) / momentOfInertia();
+    auto angular_acceleration = torque / moment_of_inertia;
+    auto end_angle = norm_rad(angle + angular_velocity * time + angular_acceleration * time * time / 2);
+    auto end_rot = end_angle == angle ? rot : Rot(end_angle);
 
-    // Use trapezium rule to integrate local forces
+    // vel_accumulator is the mean of the rotated local force over the update, and pos_accumulator its double
+    // integral divided by time squared
+    Vec vel_accumulator, pos_accumulator;
 
-    int strips = ceil(time * 100);
-    auto vel_accumulator = _local_force.rotate(_angle);
-    auto pos_accumulator = Vec{};
+    if (!local_force) {
+        // Coasting, nothing to integrate
+    }
+    else if (!angular_acceleration) {
+        integrateSpinningForce(local_force, rot, angular_velocity * time, vel_accumulator, pos_accumulator);
+    }
+    else {
+        // Use trapezium rule to integrate local forces
+
+        double strip_count = ceil(time * strips_per_second);
+        int strips = strip_count >= 1 ? static_cast<int>(min(strip_count, MAX_STRIPS)) : 1;
+        vel_accumulator = local_force.rotate(rot);
+
+        for (auto i = 1; i != strips; ++i) {
+            auto t = i / static_cast<double>(strips) * time;
+            auto strip_angle = angle + angular_velocity * t + angular_acceleration * t * t / 2;
+            auto impulse = local_force.rotate(strip_angle);
+            vel_accumulator += impulse;
+            pos_accumulator += vel_accumulator;
+            vel_accumulator += impulse;
+        }
 
-    for (auto i = 1; i != strips; ++i) {
-        auto t = i / static_cast<double>(strips) * time;
-        auto angle = _angle + _angular_velocity * t + angular_acceleration * t * t / 2;
-        auto impulse = _local_force.rotate(angle);
-        vel_accumulator += impulse;
-        pos_accumulator += vel_accumulator;
-        vel_accumulator += impulse;
+        vel_accumulator += local_force.rotate(end_rot);
+        pos_accumulator += vel_accumulator / 2;
+        vel_accumulator /= 2.0 * strips;
+        pos_accumulator /= 2.0 * strips * strips;
     }
 
-    _angle = norm_rad(_angle + _angular_velocity * time + angular_acceleration * time * time / 2);
-    _angular_velocity = _angular_velocity + angular_acceleration * time;
+    angle = end_angle;
+    rot = end_rot;
+    angular_velocity = angular_velocity + angular_acceleration * time;
 
-    vel_accumulator += _local_force.rotate(_angle);
-    pos_accumulator += vel_accumulator / 2;
-    vel_accumulator /= strips * 2;
-    pos_accumulator /= strips * strips * 2;
+    position += velocity * time + (pos_accumulator + global_force / 2) * time * time / mass;
+    velocity += (vel_accumulator + global_force) * time / mass;
+}
+
+void Body::update(double time) {
+    integrateMotion(_position, _velocity, _angle, _rot, _angular_velocity, _local_force, _global_force,
+                    _local_torque + _global_torque, mass(), momentOfInertia(), _strips_per_second, time);
+}
 
-    _position += _velocity * time + (pos_accumulator + _global_force / 2) * time * time / mass();
-    _velocity += (vel_accumulator + _global_force) * time / mass();
+void KinematicState::update(double time) {
+    integrateMotion(position, velocity, angle, rot, angular_velocity, local_force, global_force,
+                    local_torque + global_torque, mass, moment_of_inertia, strips_per_second, time);
+}
+
+void Body::setStripsPerSecond(double strips_per_second) {
+    if (!(strips_per_second > 0) || !isfinite(strips_per_second)) {
+        throw runtime_error("strips_per_second must be positive and finite");
+    }
+    _strips_per_second = strips_per_second;
 }
 
 void Body::addShape(shared_ptr<Shape> shape) {
     _shapes.push_back(shape);
+    shape->_owners.push_back(this);
+    _updateShapeCache();
 }
 
 void Body::removeShape(shared_ptr<Shape> shape) {
-    _shapes.erase(remove(_shapes.begin(), _shapes.end(), shape), _shapes.end());
+    auto end = remove(_shapes.begin(), _shapes.end(), shape);
+    if (end != _shapes.end()) {
+        _shapes.erase(end, _shapes.end());
+        auto& owners = shape->_owners;
+        owners.erase(remove(owners.begin(), owners.end(), this), owners.end());
+    }
+    _updateShapeCache();
+}
+
+void Body::_updateShapeCache() {
+    _mass = 0;
+    _moment_of_inertia = 0;
+    _bounding_radius = 0;
+    vector<ShapeTree::Leaf> leaves;
+    vector<Vec> vertices;
+    _bounded_shapes.clear();
+    for (unsigned int i = 0; i < _shapes.size(); ++i) {
+        const auto& shape = _shapes[i];
+        _mass += shape->mass;
+        _moment_of_inertia += shape->momentOfInertia() + shape->mass * shape->position.squared();
+        if (shape->canCollide()) {
+            auto radius = shape->boundingRadius();
+            // Radius of the circle around the body's position containing all the collidable shapes at any angle
+            _bounding_radius = max(_bounding_radius, shape->position.abs() + radius);
+            leaves.push_back({shape->position, radius, i});
+            if (auto polygon = dynamic_cast<const Polygon*>(shape.get())) {
+                for (const auto& point : polygon->points) {
+                    vertices.push_back(shape->position + point);
+                }
+            }
+            else {
+                _bounded_shapes.push_back(shape.get());
+            }
+        }
+    }
+    _shape_tree.build(move(leaves));
+    _hull = convexHull(move(vertices));
+    _start_aabb_angle = numeric_limits<double>::quiet_NaN();
+    for (auto i = 0; i < 4; ++i) {
+        _quadrant_aabbs[i] = _aabbAtAngle(Rot(i * hpi()));
+    }
 }
 
 void Body::addSensor(shared_ptr<Sensor> sensor) {
@@ -157,50 +284,120 @@ void Body::removeSensor(shared_ptr<Sensor> sensor) {
     _sensors.erase(remove(_sensors.begin(), _sensors.end(), sensor), _sensors.end());
 }
 
-tuple<CollisionTimeResult, Shape*, Shape*> Body::collide(Body* other, double end_time, bool ignore_initial) const {
+// Margin left for the narrowphase's contact tolerance when culling
+const double CULL_MARGIN = 1e-6;
+
+// Over time, how far the body can stray from moving in a straight line, and how far it can turn
+static void motionBounds(const Body& body, double time, double& drift, double& turn) {
+    drift = (body.globalForce().abs() + body.localForce().abs()) / body.mass() * time * time / 2;
+    turn = min(pi(), abs(body.angularVelocity()) * time
+                     + abs(body.localTorque() + body.globalTorque()) / body.momentOfInertia() * time * time / 2);
+}
+
+tuple<CollisionTimeResult, Shape*, Shape*> Body::collide(Body* other, double end_time, bool ignore_initial,
+                                                         TOISolver solver/*=TOISolver::conservative*/) const {
     auto soonest = CollisionTimeResult{};
-    Shape* a;
-    Shape* b;
+    unsigned int a = 0, b = 0;
     soonest.time = end_time + 1;
-    for (const auto my_shape : _shapes) {
-        if (!my_shape->canCollide()) {
+    unsigned int iterations = 0, culled = 0;
+
+    // Walk the two shape trees, only going into pairs of subtrees whose bounding circles can meet. Their centres
+    // follow the bodies' straight-line motion, give or take the drift from the forces and the chord swept by turning.
+    const auto& my_nodes = _shape_tree.nodes();
+    const auto& their_nodes = other->_shape_tree.nodes();
+    double my_drift, my_turn, their_drift, their_turn;
+    motionBounds(*this, end_time, my_drift, my_turn);
+    motionBounds(*other, end_time, their_drift, their_turn);
+    auto my_chord = 2 * sin(my_turn / 2), their_chord = 2 * sin(their_turn / 2);
+    auto vel_diff = other->_velocity - _velocity;
+    auto vel_squared = vel_diff.squared();
+
+    thread_local vector<pair<int, int>> stack;
+    stack.clear();
+    if (!my_nodes.empty() && !their_nodes.empty()) {
+        stack.emplace_back(0, 0);
+    }
+    while (!stack.empty()) {
+        auto i = stack.back().first, j = stack.back().second;
+        stack.pop_back();
+        const auto& my_node = my_nodes[i];
+        const auto& their_node = their_nodes[j];
+
+        auto offset = other->_position + their_node.centre.rotate(other->_rot) - _position - my_node.centre.rotate(_rot);
+        // Closest approach of the centres over [0, end_time]
+        auto closest_time = vel_squared ? max(0.0, min(end_time, -offset.dot(vel_diff) / vel_squared)) : 0;
+        auto reach = my_node.radius + my_drift + my_node.centre.abs() * my_chord
+                     + their_node.radius + their_drift + their_node.centre.abs() * their_chord + CULL_MARGIN;
+        if ((offset + vel_diff * closest_time).squared() > reach * reach) {
+            culled += my_node.leaves * their_node.leaves;
             continue;
         }
-        for (const auto their_shape : other->_shapes) {
-            if (!their_shape->canCollide()) {
-                continue;
-            }
-            auto collr = collideShapes(*my_shape, *this, *their_shape, *other, end_time, ignore_initial);
-            if (collr.time != -1 && collr.time < soonest.time) {
+
+        if (my_node.leaf() && their_node.leaf()) {
+            auto collr = collideShapes(*_shapes[my_node.index], *this, *other->_shapes[their_node.index], *other,
+                                       end_time, ignore_initial, solver);
+            iterations += collr.iterations;
+            // Break ties by shape order, which does not depend on the shape of the trees
+            if (collr.time != -1 && (collr.time < soonest.time
+                                     || (collr.time == soonest.time && make_pair(my_node.index, their_node.index) < make_pair(a, b)))) {
                 soonest = move(collr);
-                a = my_shape.get();
-                b = their_shape.get();
+                a = my_node.index;
+                b = their_node.index;
             }
         }
+        else if (their_node.leaf() || (!my_node.leaf() && my_node.radius >= their_node.radius)) {
+            stack.emplace_back(i + 1, j);
+            stack.emplace_back(my_node.second, j);
+        }
+        else {
+            stack.emplace_back(i, j + 1);
+            stack.emplace_back(i, their_node.second);
+        }
     }
+    // Report the work done over all the shape pairs
+    soonest.iterations = iterations;
+    soonest.culled = culled;
     if (soonest.time < end_time) {
-        return {soonest, a, b};
+        return {soonest, _shapes[a].get(), other->_shapes[b].get()};
     }
     soonest.time = -1;
     return {soonest, nullptr, nullptr};
 }
 
 double Body::distanceBetween(Body* other) const {
-    bool initial = true;
-    double dist = (other->_position - _position).abs();
-    for (const auto my_shape : _shapes) {
-        if (!my_shape->canCollide()) {
+    const auto& my_nodes = _shape_tree.nodes();
+    const auto& their_nodes = other->_shape_tree.nodes();
+    if (my_nodes.empty() || their_nodes.empty()) {
+        return (other->_position - _position).abs();
+    }
+
+    // Branch and bound over the shape trees, skipping subtrees that are further apart than the closest shapes so far
+    auto dist = numeric_limits<double>::infinity();
+    thread_local vector<pair<int, int>> stack;
+    stack.clear();
+    stack.emplace_back(0, 0);
+    while (!stack.empty()) {
+        auto i = stack.back().first, j = stack.back().second;
+        stack.pop_back();
+        const auto& my_node = my_nodes[i];
+        const auto& their_node = their_nodes[j];
+
+        auto apart = (other->_position + their_node.centre.rotate(other->_rot) - _position - my_node.centre.rotate(_rot)).abs()
+                     - my_node.radius - their_node.radius;
+        if (apart > 0 && apart >= dist) {
             continue;
         }
-        for (const auto their_shape : other->_shapes) {
-            if (!their_shape->canCollide()) {
-                continue;
-            }
-            auto d = ::distanceBetween(*my_shape, *this, *their_shape, *other).distance;
-            if (initial || d < dist) {
-                dist = d;
-                initial = false;
-            }
+
+        if (my_node.leaf() && their_node.leaf()) {
+            dist = min(dist, ::distanceBetween(*_shapes[my_node.index], *this, *other->_shapes[their_node.index], *other).distance);
+        }
+        else if (their_node.leaf() || (!my_node.leaf() && my_node.radius >= their_node.radius)) {
+            stack.emplace_back(i + 1, j);
+            stack.emplace_back(my_node.second, j);
+        }
+        else {
+            stack.emplace_back(i, j + 1);
+            stack.emplace_back(i, their_node.second);
         }
     }
     return dist;
@@ -254,6 +451,10 @@ BodyState Body::state() const {
             _angle, _angular_velocity};
 }
 
+KinematicState Body::kinematicState() const {
+    return {state(), _rot, mass(), momentOfInertia(), _strips_per_second};
+}
+
 void Body::reset(BodyState state) {
     _position = state.position;
     _velocity = state.velocity;
@@ -262,5 +463,6 @@ void Body::reset(BodyState state) {
     _local_torque = state.local_torque;
     _global_torque = state.global_torque;
     _angle = state.angle;
+    _rot = Rot(_angle);
     _angular_velocity = state.angular_velocity;
 }
@@ -29,6 +29,7 @@
 #include "collisions.hpp"
 #include "shape.hpp"
 #include "sensor.hpp"
+#include "shapetree.hpp"
 
 namespace shyphe {
     struct BodyState {
@@ -50,15 +51,42 @@ namespace shyphe {
         friend class Body;
     };
 
+    // BodyState plus the rotation and mass properties, enough to advance a body without copying its shapes and
+    // sensors. rot is kept equal to Rot(angle) by update.
+    struct KinematicState : BodyState {
+        KinematicState(const BodyState& state, const Rot& rot_, double mass_, double moment_of_inertia_,
+                       double strips_per_second_) : BodyState(state), rot(rot_), mass(mass_),
+                                                    moment_of_inertia(moment_of_inertia_),
+                                                    strips_per_second(strips_per_second_) {
+        }
+
+        Rot rot;
+        double mass, moment_of_inertia, strips_per_second;
+
+        void update(double time);
+    };
+
     class Body : public std::enable_shared_from_this<Body> {
     public:
         Body(const Vec& position_={}, const Vec& velocity_={},
              double angle_=0, double angular_velocity_=0, int side_=0);
-        virtual ~Body() = default;
+        Body(const Body& other) = delete;
+        Body& operator=(const Body& other) = delete;
+        virtual ~Body();
 
         AABB aabb(double time) const;
-        double mass() const;
-        double momentOfInertia() const;
+
+        inline double mass() const {
+            return _mass;
+        }
+
+        inline double momentOfInertia() const {
+            return _moment_of_inertia;
+        }
+
+        inline double boundingRadius() const {
+            return _bounding_radius;
+        }
 
         inline const Vec& position() const {
             return _position;
@@ -72,6 +100,10 @@ namespace shyphe {
             return _angle;
         }
 
+        inline const Rot& rot() const {
+            return _rot;
+        }
+
         inline double angularVelocity() const {
             return _angular_velocity;
         }
@@ -96,6 +128,19 @@ namespace shyphe {
             return _side;
         }
 
+        // Whether World::step should pass this body's collisions to its callback
+        inline bool notifyCollisions() const {
+            return _notify_collisions;
+        }
+
+        inline void setNotifyCollisions(bool notify) {
+            _notify_collisions = notify;
+        }
+
+        inline double stripsPerSecond() const {
+            return _strips_per_second;
+        }
+
         inline const std::vector<SensedObject>& sensorView() const {
             return _sensor_view;
         }
@@ -119,27 +164,56 @@ namespace shyphe {
 
         Signature signature();
         void update(double time);
+        void setStripsPerSecond(double strips_per_second);
         void addShape(std::shared_ptr<Shape> shape);
         void removeShape(std::shared_ptr<Shape> shape);
         void addSensor(std::shared_ptr<Sensor> shape);
         void removeSensor(std::shared_ptr<Sensor> shape);
-        std::tuple<CollisionTimeResult, Shape*, Shape*> collide(Body* other, double end_time, bool ignore_initial) const;
+        std::tuple<CollisionTimeResult, Shape*, Shape*> collide(Body* other, double end_time, bool ignore_initial,
+                                                                TOISolver solver=TOISolver::conservative) const;
         double distanceBetween(Body* other) const;
         double maxSensorRange() const;
 
         BodyState state() const;
+        KinematicState kinematicState() const;
         void reset(BodyState state);
     private:
         Vec _position, _velocity;
         Vec _local_force = {}, _global_force = {};
         double _local_torque = 0, _global_torque = 0;
         double _angle, _angular_velocity;
+        // Rot(_angle), refreshed whenever _angle changes
+        Rot _rot;
+        // Cached from _shapes, refreshed when a shape is added, removed or changed. Kept next to the motion state,
+        // as Body::update needs both.
+        double _mass = 0, _moment_of_inertia = 0, _bounding_radius = 0;
         int _side;
+        bool _notify_collisions = false;
+        // Trapezium rule resolution, only used when the local force is applied during angular acceleration
+        double _strips_per_second = 100;
         std::vector<SensedObject> _sensor_view;
 
         std::vector<std::shared_ptr<Shape>> _shapes;
         std::vector<std::shared_ptr<Sensor>> _sensors;
 
+        AABB _quadrant_aabbs[4] = {{0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}};
+        // The collidable shapes' outline for aabb: the convex hull of the polygons' vertices in body coordinates,
+        // and the other shapes, which are bounded with Shape::aabb
+        std::vector<Vec> _hull;
+        std::vector<const Shape*> _bounded_shapes;
+        // aabb's bounds at the current angle, reused until the body turns. NaN when stale.
+        mutable AABB _start_aabb = {0, 0, 0, 0};
+        mutable double _start_aabb_angle = 0;
+        // Bounding circles of the collidable shapes, for collide and distanceBetween
+        ShapeTree _shape_tree;
+
+        void _updateShapeCache();
+        AABB _aabbAtAngle(const Rot& rot) const;
+
+        // Index into the World's body slots, -1 when not in a world
+        int _world_slot = -1;
+
+        friend class Shape;
         friend class World;
     };
 }
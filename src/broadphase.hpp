@@ -0,0 +1,50 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_BROADPHASE_HPP
+#define SHYPHE_BROADPHASE_HPP
+
+#include <vector>
+#include <utility>
+
+namespace shyphe {
+    class Body;
+
+    enum class BroadphaseType {
+        sat_axes,
+        aabb_tree,
+        spatial_hash
+    };
+
+    // Finds the pairs of bodies whose swept AABBs overlap. Pairs are ordered (first < second) and returned sorted,
+    // so the collision order does not depend on the broadphase. updateBody may defer work until flush, which must
+    // be called before querying.
+    class Broadphase {
+    public:
+        virtual ~Broadphase() = default;
+        virtual void updateBody(Body* body, double time) = 0;
+        virtual void removeBody(Body* body) = 0;
+        virtual void flush() {
+        }
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions() const = 0;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions(const std::vector<Body*>& bodies) const = 0;
+    };
+}
+
+#endif // SHYPHE_BROADPHASE_HPP
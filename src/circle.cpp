@@ -24,7 +24,7 @@ using namespace std;
 using namespace shyphe;
 
 Circle::Circle(double radius_/*=0*/, double mass_/*=0*/, const Vec& position_/*={}*/,
-               double radar_cross_section/*=0*/, double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : Shape(mass_,
+               double radar_cross_section/*=0*/, double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : Shape(CIRCLE_KIND, mass_,
                                                                                                                        position_,
                                                                                                                        radar_cross_section,
                                                                                                                        radar_emissions,
@@ -32,7 +32,7 @@ Circle::Circle(double radius_/*=0*/, double mass_/*=0*/, const Vec& position_/*=
                                                                                                                  radius(radius_) {
 }
 
-AABB Circle::aabb(double /*angle*/) const
+AABB Circle::aabb(const Rot& /*rot*/) const
 {
     return {-radius, radius, -radius, radius};
 }
@@ -45,10 +45,6 @@ bool Circle::canCollide() const {
     return true;
 }
 
-type_index Circle::shape_type() const {
-    return {typeid(Circle)};
-}
-
 double Circle::boundingRadius() const {
     return radius;
 }
@@ -0,0 +1,157 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "collisionqueue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace shyphe;
+
+bool CollisionQueue::_before(size_t a, size_t b) const {
+    const auto& ea = entries[a];
+    const auto& eb = entries[b];
+    if (ea.collision.result.time != eb.collision.result.time) {
+        return ea.collision.result.time < eb.collision.result.time;
+    }
+    return ea.sequence > eb.sequence;
+}
+
+void CollisionQueue::_siftUp(size_t index) {
+    auto entry = heap[index];
+    while (index) {
+        auto parent = (index - 1) / 2;
+        if (!_before(entry, heap[parent])) {
+            break;
+        }
+        heap[index] = heap[parent];
+        entries[heap[index]].heap_index = index;
+        index = parent;
+    }
+    heap[index] = entry;
+    entries[entry].heap_index = index;
+}
+
+void CollisionQueue::_siftDown(size_t index) {
+    auto entry = heap[index];
+    auto size = heap.size();
+    while (true) {
+        auto child = index * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && _before(heap[child + 1], heap[child])) {
+            ++child;
+        }
+        if (!_before(heap[child], entry)) {
+            break;
+        }
+        heap[index] = heap[child];
+        entries[heap[index]].heap_index = index;
+        index = child;
+    }
+    heap[index] = entry;
+    entries[entry].heap_index = index;
+}
+
+void CollisionQueue::_erase(size_t entry) {
+    auto index = entries[entry].heap_index;
+    auto last = heap.back();
+    heap.pop_back();
+    if (last != entry) {
+        heap[index] = last;
+        entries[last].heap_index = index;
+        if (index && _before(last, heap[(index - 1) / 2])) {
+            _siftUp(index);
+        }
+        else {
+            _siftDown(index);
+        }
+    }
+    // Invalidates all the references to this entry
+    ++entries[entry].generation;
+    free_entries.push_back(entry);
+}
+
+void CollisionQueue::_addRef(Body* body, EntryRef ref) {
+    auto& refs = body_entries[body];
+    if (refs.size() == refs.capacity()) {
+        // Drop references to collisions that have already left the queue before growing
+        refs.erase(remove_if(refs.begin(), refs.end(),
+                             [this](const EntryRef& r){return entries[r.first].generation != r.second;}),
+                   refs.end());
+    }
+    refs.push_back(ref);
+}
+
+void CollisionQueue::push(const ScheduledCollision& collision) {
+    size_t entry;
+    if (free_entries.size()) {
+        entry = free_entries.back();
+        free_entries.pop_back();
+    }
+    else {
+        entry = entries.size();
+        entries.push_back({collision, 0, 0, 0});
+    }
+    auto& e = entries[entry];
+    e.collision = collision;
+    e.sequence = sequence++;
+    heap.push_back(entry);
+    _siftUp(heap.size() - 1);
+
+    _addRef(collision.a, {entry, e.generation});
+    if (collision.b != collision.a) {
+        _addRef(collision.b, {entry, e.generation});
+    }
+}
+
+const ScheduledCollision& CollisionQueue::top() const {
+    if (heap.empty()) {
+        throw runtime_error("Collision queue is empty");
+    }
+    return entries[heap.front()].collision;
+}
+
+ScheduledCollision CollisionQueue::pop() {
+    auto collision = top();
+    _erase(heap.front());
+    return collision;
+}
+
+void CollisionQueue::removeBody(Body* body) {
+    auto iter = body_entries.find(body);
+    if (iter == body_entries.end()) {
+        return;
+    }
+    for (const auto& ref : iter->second) {
+        if (entries[ref.first].generation == ref.second) {
+            _erase(ref.first);
+        }
+    }
+    body_entries.erase(iter);
+}
+
+void CollisionQueue::clear() {
+    entries.clear();
+    free_entries.clear();
+    heap.clear();
+    body_entries.clear();
+}
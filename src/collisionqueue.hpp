@@ -0,0 +1,82 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_COLLISIONQUEUE_HPP
+#define SHYPHE_COLLISIONQUEUE_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include "collisions.hpp"
+
+namespace shyphe {
+    class Body;
+    class Shape;
+
+    struct ScheduledCollision {
+        CollisionTimeResult result;
+        Shape* a_shape;
+        Body* a;
+        Shape* b_shape;
+        Body* b;
+    };
+
+    // Min-heap of collisions ordered by time, indexed by body so that all the collisions
+    // of one body can be dropped without scanning the whole queue. Collisions with the same
+    // time come out in reverse order of insertion.
+    class CollisionQueue {
+    public:
+        void push(const ScheduledCollision& collision);
+        const ScheduledCollision& top() const;
+        ScheduledCollision pop();
+        void removeBody(Body* body);
+        void clear();
+
+        inline bool empty() const {
+            return heap.empty();
+        }
+
+        inline std::size_t size() const {
+            return heap.size();
+        }
+    private:
+        struct Entry {
+            ScheduledCollision collision;
+            unsigned long sequence;
+            std::size_t heap_index;
+            unsigned int generation;
+        };
+        typedef std::pair<std::size_t, unsigned int> EntryRef;
+
+        std::vector<Entry> entries;
+        std::vector<std::size_t> free_entries;
+        std::vector<std::size_t> heap;
+        std::unordered_map<Body*, std::vector<EntryRef>> body_entries;
+        unsigned long sequence = 0;
+
+        bool _before(std::size_t a, std::size_t b) const;
+        void _siftUp(std::size_t index);
+        void _siftDown(std::size_t index);
+        void _erase(std::size_t entry);
+        void _addRef(Body* body, EntryRef ref);
+    };
+}
+
+#endif // SHYPHE_COLLISIONQUEUE_HPP
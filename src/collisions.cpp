@@ -22,9 +22,11 @@
 #include "circle.hpp"
 #include "polygon.hpp"
 #include "body.hpp"
-#include <typeindex>
-#include <map>
+#include "projection.hpp"
+#include "gjk.hpp"
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 #include <tuple>
 
 using namespace std;
@@ -32,77 +34,272 @@ using namespace shyphe;
 
 const double COLLISION_LIMIT = 1e-8;
 const unsigned int MAX_ITERATIONS = 1000;
-typedef DistanceResult (*DistanceDispatch)(const Shape&, const Body&, const Shape&, const Body&);
 
-const map<pair<type_index, type_index>, DistanceDispatch> DISPATCH_TABLE = {
-    {{type_index(typeid(Circle)), type_index(typeid(Circle))}, &distanceBetweenCircleCircle},
-    {{type_index(typeid(Circle)), type_index(typeid(Polygon))}, &distanceBetweenCirclePolygon},
-    {{type_index(typeid(Polygon)), type_index(typeid(Circle))}, &distanceBetweenPolygonCircle},
-    {{type_index(typeid(Polygon)), type_index(typeid(Polygon))}, &distanceBetweenPolygonPolygon}
+struct shyphe::DistanceCache {
+    // The closest features of the last polygon-polygon query, GJK starts from them
+    Simplex simplex;
 };
 
+// Indexed by the kinds of the two shapes, the distance functions can rely on the shapes being of their kind
+static DistanceFunction DISPATCH_TABLE[MAX_SHAPE_KINDS][MAX_SHAPE_KINDS] = {
+    // MASS_SHAPE_KIND
+    {},
+    // CIRCLE_KIND
+    {nullptr, &distanceBetweenCircleCircle, &distanceBetweenCirclePolygon},
+    // POLYGON_KIND
+    {nullptr, &distanceBetweenPolygonCircle, &distanceBetweenPolygonPolygon}
+};
+static unsigned int next_shape_kind = BUILTIN_SHAPE_KINDS;
+
+static inline DistanceFunction distanceFunction(const Shape& a, const Shape& b) {
+    auto dist_func = DISPATCH_TABLE[a.kind()][b.kind()];
+    if (!dist_func) {
+        throw out_of_range("no distance function for these shape kinds");
+    }
+    return dist_func;
+}
+
+unsigned int shyphe::registerShapeKind() {
+    if (next_shape_kind == MAX_SHAPE_KINDS) {
+        throw runtime_error("too many shape kinds, increase MAX_SHAPE_KINDS");
+    }
+    return next_shape_kind++;
+}
+
+void shyphe::registerDistanceFunction(unsigned int a_kind, unsigned int b_kind, DistanceFunction func) {
+    if (a_kind >= next_shape_kind || b_kind >= next_shape_kind) {
+        throw out_of_range("unregistered shape kind");
+    }
+    DISPATCH_TABLE[a_kind][b_kind] = func;
+}
+
 DistanceResult shyphe::distanceBetween(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body) {
-    DistanceDispatch dist_func = DISPATCH_TABLE.at(make_pair(a.shape_type(), b.shape_type()));
-    return dist_func(a, a_body, b, b_body);
+    DistanceCache cache;
+    return distanceFunction(a, b)(a, a_body.kinematicState(), b, b_body.kinematicState(), cache);
 }
 
-CollisionTimeResult shyphe::collideShapes(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body, double end_time, bool ignore_initial) {
+// Speed at which the touching points are closing along the normal
+inline double closingSpeed(const DistanceResult& dist, const Vec& vel_diff, const KinematicState& a_body, const KinematicState& b_body) {
+    auto vel_at = vel_diff
+                  - (dist.a_point - a_body.position).perp() * a_body.angular_velocity
+                  + (dist.b_point - b_body.position).perp() * b_body.angular_velocity;
+    return vel_at.dot(dist.normal);
+}
+
+inline CollisionTimeResult touchResult(double time, const DistanceResult& dist, unsigned int iterations) {
+    CollisionTimeResult result{time, (dist.a_point + dist.b_point) / 2.0, dist.normal};
+    result.iterations = iterations;
+    return result;
+}
+
+inline CollisionTimeResult missResult(unsigned int iterations) {
+    CollisionTimeResult result;
+    result.iterations = iterations;
+    return result;
+}
+
+static CollisionTimeResult collideConservative(DistanceFunction dist_func, const Shape& a, KinematicState abody, const Shape& b, KinematicState bbody,
+                                               double end_time, bool ignore_initial, DistanceCache& cache) {
     // Based on algorithm from bottom of http://www.wildbunny.co.uk/blog/2011/04/20/collision-detection-for-dummies/
-    DistanceDispatch dist_func = DISPATCH_TABLE.at(make_pair(a.shape_type(), b.shape_type()));
-    Body abody = a_body, bbody = b_body;
-    auto vel_diff = abody.velocity() - bbody.velocity();
+    auto vel_diff = abody.velocity - bbody.velocity;
     DistanceResult current_distance;
     double time = 0;
     unsigned int iteration = 0;
     while (iteration < MAX_ITERATIONS) {
-        current_distance = dist_func(a, abody, b, bbody);
+        current_distance = dist_func(a, abody, b, bbody, cache);
         double add_time = 0;
 
         if (current_distance.distance < COLLISION_LIMIT) {
-            auto vel_at = vel_diff
-                          - (current_distance.a_point - abody.position()).perp() * abody.angularVelocity()
-                          + (current_distance.b_point - bbody.position()).perp() * bbody.angularVelocity();
-            if (vel_at.dot(current_distance.normal) > COLLISION_LIMIT && !ignore_initial) {
-                return {time, (current_distance.a_point + current_distance.b_point) / 2.0, current_distance.normal};
+            auto vel_at = closingSpeed(current_distance, vel_diff, abody, bbody);
+            if (vel_at > COLLISION_LIMIT && !ignore_initial) {
+                return touchResult(time, current_distance, iteration + 1);
             }
-            add_time += max(COLLISION_LIMIT * 3, COLLISION_LIMIT * 3 / abs(vel_at.dot(current_distance.normal)));
+            add_time += max(COLLISION_LIMIT * 3, COLLISION_LIMIT * 3 / abs(vel_at));
         }
         else {
             ignore_initial = false;
         }
         double time_left = end_time - time;
         double vel = vel_diff.dot(current_distance.normal)
-                     + (abody.globalForce().abs() + abody.localForce().abs()) / abody.mass() * time_left
-                     + (bbody.globalForce().abs() + bbody.localForce().abs()) / bbody.mass() * time_left
+                     + (abody.global_force.abs() + abody.local_force.abs()) / abody.mass * time_left
+                     + (bbody.global_force.abs() + bbody.local_force.abs()) / bbody.mass * time_left
                      + (a.position.abs() + a.boundingRadius())
-                         * abs(abody.angularVelocity() + (abody.localTorque() + abody.globalTorque()) / abody.momentOfInertia() * time_left)
+                         * abs(abody.angular_velocity + (abody.local_torque + abody.global_torque) / abody.moment_of_inertia * time_left)
                      + (b.position.abs() + b.boundingRadius())
-                         * abs(bbody.angularVelocity() + (bbody.localTorque() + bbody.globalTorque()) / bbody.momentOfInertia() * time_left);
+                         * abs(bbody.angular_velocity + (bbody.local_torque + bbody.global_torque) / bbody.moment_of_inertia * time_left);
 
         if (vel <= 0) {
-            return {};
+            return missResult(iteration + 1);
         }
 
         add_time += abs(current_distance.distance) / vel;
         time += add_time;
 
         if (time < 0 || time > end_time) {
-            return {};
+            return missResult(iteration + 1);
+        }
+
+        abody.update(add_time);
+        bbody.update(add_time);
+        ++iteration;
+    }
+    return missResult(iteration);
+}
+
+// Longest step over which the shapes cannot close by more than distance along normal, infinite if they never close.
+// Unlike the conservative bound this uses the current velocities, and lets the forces act over the step rather than
+// the whole remaining window.
+static double safeStep(const Shape& a, const KinematicState& abody, const Shape& b, const KinematicState& bbody, double distance, const Vec& normal) {
+    auto a_radius = a.position.abs() + a.boundingRadius();
+    auto b_radius = b.position.abs() + b.boundingRadius();
+    double speed = (abody.velocity - bbody.velocity).dot(normal)
+                   + a_radius * abs(abody.angular_velocity) + b_radius * abs(bbody.angular_velocity);
+    double accel = (abody.global_force.abs() + abody.local_force.abs()) / abody.mass
+                   + (bbody.global_force.abs() + bbody.local_force.abs()) / bbody.mass
+                   + a_radius * abs(abody.local_torque + abody.global_torque) / abody.moment_of_inertia
+                   + b_radius * abs(bbody.local_torque + bbody.global_torque) / bbody.moment_of_inertia;
+
+    // Smallest positive root of speed * t + accel * t^2 / 2 = distance
+    if (accel > 0) {
+        auto root = sqrt(speed * speed + 2 * accel * distance);
+        return speed > 0 ? 2 * distance / (speed + root) : (root - speed) / accel;
+    }
+    if (speed > 0) {
+        return distance / speed;
+    }
+    return numeric_limits<double>::infinity();
+}
+
+static CollisionTimeResult collideBilateral(DistanceFunction dist_func, const Shape& a, KinematicState abody, const Shape& b, KinematicState bbody,
+                                            double end_time, bool ignore_initial, DistanceCache& cache) {
+    // Conservative advancement from below, as Box2D's time of impact does. Alongside, the distance is probed where
+    // it looks like reaching zero, first at the end of the window and then by extrapolating the last step. Once a
+    // probe overlaps, the root in between is chased with regula falsi (Illinois variant).
+    const double target = COLLISION_LIMIT / 2;
+    double time = 0, last_time = 0;
+    auto current_distance = dist_func(a, abody, b, bbody, cache);
+    double last_distance = current_distance.distance;
+    unsigned int iteration = 1;
+    // Earliest probe found clear, and the earliest known overlap
+    double clear_time = numeric_limits<double>::infinity();
+    bool bracketed = false;
+    double hi_time = end_time, hi_distance = 0;
+    // Illinois weights, halved each time the same end is kept again
+    double lo_weight = 1, hi_weight = 1;
+    unsigned int lo_kept = 0, hi_kept = 0;
+
+    while (iteration < MAX_ITERATIONS) {
+        double add_time;
+        if (current_distance.distance < COLLISION_LIMIT) {
+            auto vel_at = closingSpeed(current_distance, abody.velocity - bbody.velocity, abody, bbody);
+            if (vel_at > COLLISION_LIMIT && !ignore_initial) {
+                return touchResult(time, current_distance, iteration);
+            }
+            // Step out of the contact, and past any overlap as the conservative solver does
+            add_time = max(COLLISION_LIMIT * 3, COLLISION_LIMIT * 3 / abs(vel_at))
+                       + safeStep(a, abody, b, bbody, abs(current_distance.distance), current_distance.normal);
+        }
+        else {
+            ignore_initial = false;
+            add_time = safeStep(a, abody, b, bbody, current_distance.distance, current_distance.normal);
+        }
+        if (!(time + add_time <= end_time)) {
+            return missResult(iteration);
+        }
+
+        // Only probe once advancement is seen to be slow, it is hard to beat when the bound is tight
+        if (!bracketed && time > 0 && current_distance.distance >= COLLISION_LIMIT
+                && current_distance.distance > last_distance / 2) {
+            double guess = end_time;
+            if (clear_time <= end_time) {
+                guess = last_distance > current_distance.distance
+                    ? time + (current_distance.distance - target) * (time - last_time) / (last_distance - current_distance.distance)
+                    : clear_time;
+            }
+            if (guess < clear_time && guess > time + add_time) {
+                auto a_guess = abody, b_guess = bbody;
+                a_guess.update(guess - time);
+                b_guess.update(guess - time);
+                auto guess_distance = dist_func(a, a_guess, b, b_guess, cache).distance;
+                ++iteration;
+                if (guess_distance < target) {
+                    bracketed = true;
+                    hi_time = guess;
+                    hi_distance = guess_distance - target;
+                }
+                else {
+                    clear_time = guess;
+                }
+            }
+        }
+
+        if (bracketed && current_distance.distance >= COLLISION_LIMIT && hi_time > time) {
+            auto lo_distance = (current_distance.distance - target) * lo_weight;
+            double secant = lo_distance * (hi_time - time) / (lo_distance - hi_distance * hi_weight);
+            if (secant > add_time) {
+                add_time = min(secant, hi_time - time);
+                auto a_next = abody, b_next = bbody;
+                a_next.update(add_time);
+                b_next.update(add_time);
+                auto next_distance = dist_func(a, a_next, b, b_next, cache);
+                ++iteration;
+                if (next_distance.distance < 0) {
+                    hi_time = time + add_time;
+                    hi_distance = next_distance.distance - target;
+                    hi_kept = 0;
+                    hi_weight = 1;
+                    if (++lo_kept >= 2) {
+                        lo_weight /= 2;
+                    }
+                }
+                else {
+                    last_time = time;
+                    last_distance = current_distance.distance;
+                    time += add_time;
+                    abody = a_next;
+                    bbody = b_next;
+                    current_distance = next_distance;
+                    lo_kept = 0;
+                    lo_weight = 1;
+                    if (++hi_kept >= 2) {
+                        hi_weight /= 2;
+                    }
+                }
+                continue;
+            }
         }
 
+        last_time = time;
+        last_distance = current_distance.distance;
+        lo_kept = 0;
+        lo_weight = 1;
+        time += add_time;
         abody.update(add_time);
         bbody.update(add_time);
+        current_distance = dist_func(a, abody, b, bbody, cache);
         ++iteration;
     }
-    return {};
+    return missResult(iteration);
+}
+
+CollisionTimeResult shyphe::collideShapes(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body, double end_time, bool ignore_initial,
+                                          TOISolver solver/*=TOISolver::conservative*/) {
+    auto dist_func = distanceFunction(a, b);
+    // Each step of the search moves the shapes a little, so the last closest features are a good start for the next
+    DistanceCache cache;
+    if (solver == TOISolver::bilateral) {
+        return collideBilateral(dist_func, a, a_body.kinematicState(), b, b_body.kinematicState(), end_time, ignore_initial, cache);
+    }
+    return collideConservative(dist_func, a, a_body.kinematicState(), b, b_body.kinematicState(), end_time, ignore_initial, cache);
 }
 
-DistanceResult shyphe::distanceBetweenCircleCircle(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body) {
-    const auto& a_circle = dynamic_cast<const Circle&>(a);
-    const auto& b_circle = dynamic_cast<const Circle&>(b);
+DistanceResult shyphe::distanceBetweenCircleCircle(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                   DistanceCache& /*cache*/) {
+    const auto& a_circle = static_cast<const Circle&>(a);
+    const auto& b_circle = static_cast<const Circle&>(b);
 
-    auto apos = a_body.position() + a_circle.position.rotate(a_body.angle());
-    auto bpos = b_body.position() + b_circle.position.rotate(b_body.angle());
+    auto apos = a_body.position + a_circle.position.rotate(a_body.rot);
+    auto bpos = b_body.position + b_circle.position.rotate(b_body.rot);
     auto ray = bpos - apos;
     auto norm = ray ? ray.norm() : Vec{1, 0};
     return {ray.abs() - a_circle.radius - b_circle.radius, apos + a_circle.radius * norm, bpos - b_circle.radius * norm, norm};
@@ -157,78 +354,95 @@ int updateMinimumDistance(DistanceResult& dist, Vec point, Vec l1, Vec l2, Vec l
     return number;
 }
 
-DistanceResult shyphe::distanceBetweenCirclePolygon(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body) {
-    const auto& a_circle = dynamic_cast<const Circle&>(a);
-    const auto& b_poly = dynamic_cast<const Polygon&>(b);
+DistanceResult shyphe::distanceBetweenCirclePolygon(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                    DistanceCache& /*cache*/) {
+    const auto& a_circle = static_cast<const Circle&>(a);
+    const auto& b_poly = static_cast<const Polygon&>(b);
+
+    // Rotate the polygon once rather than twice per edge
+    thread_local RotatedPoints b_points;
+    b_points.assign(b_poly.points, b_body.rot);
 
-    auto apos = a_body.position() + a_circle.position.rotate(a_body.angle());
-    auto bpos = b_body.position() + b_poly.position.rotate(b_body.angle());
+    auto apos = a_body.position + a_circle.position.rotate(a_body.rot);
+    auto bpos = b_body.position + b_points.rotate(b_poly.position);
     DistanceResult d;
 
-    for (unsigned int i = 0; i < b_poly.points.size(); ++i) {
-        auto p1 = b_poly.points[i].rotate(b_body.angle()), p2 = b_poly.points[(i + 1) % b_poly.points.size()].rotate(b_body.angle());
-        updateMinimumDistance(d, apos, p1, p2, bpos, 0, !i, false);
+    for (unsigned int i = 0; i < b_points.size(); ++i) {
+        updateMinimumDistance(d, apos, b_points[i], b_points[(i + 1) % b_points.size()], bpos, 0, !i, false);
     }
     d.a_point += d.normal * a_circle.radius;
     d.distance -= a_circle.radius;
     return d;
 }
 
-DistanceResult shyphe::distanceBetweenPolygonCircle(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body) {
-    auto d = distanceBetweenCirclePolygon(b, b_body, a, a_body);
+DistanceResult shyphe::distanceBetweenPolygonCircle(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                    DistanceCache& cache) {
+    auto d = distanceBetweenCirclePolygon(b, b_body, a, a_body, cache);
     return {d.distance, d.b_point, d.a_point, -d.normal};
 }
 
-tuple<double, Vec, Vec> axis_proj(const vector<Vec>& points, Vec axis, double angle) {
-    double min;
-    bool initial = true;
-    Vec p1, p2;
-    for (const auto& point : points) {
-        auto rpoint = point.rotate(angle);
-        auto dot = rpoint.dot(axis);
-        if (initial || dot < min) {
-            min = dot;
-            p1 = p2 = rpoint;
-            initial = false;
-        }
-        else if (dot == min) {
-            p2 = rpoint;
-        }
+// Ends of the edge between two neighbouring points, in winding order. False if they are not neighbours.
+static bool windingEdge(const RotatedPoints& points, unsigned int first, unsigned int second, Vec& l1, Vec& l2) {
+    if ((first + 1) % points.size() == second) {
+        l1 = points[first];
+        l2 = points[second];
+        return true;
+    }
+    if ((second + 1) % points.size() == first) {
+        l1 = points[second];
+        l2 = points[first];
+        return true;
     }
-    return {min, p1, p2};
+    return false;
 }
 
-tuple<double, Vec, Vec, Vec, Vec> axis_proj_poly(const Polygon& a_poly, const Polygon& b_poly, Vec ray, double a_angle, double b_angle) {
+tuple<double, Vec, Vec, Vec, Vec> axis_proj_poly(const RotatedPoints& a_points, const RotatedPoints& b_points, Vec ray) {
     tuple<double, Vec, Vec, Vec, Vec> res;
 
-    for (unsigned int i = 0; i < a_poly.points.size(); ++i) {
-        auto v1 = a_poly.points[i].rotate(a_angle), v2 = a_poly.points[(i + 1) % a_poly.points.size()].rotate(a_angle);
+    // The edge normals turn steadily round A, so B's closest point moves steadily round B, and each search can start
+    // where the last one finished
+    pair<size_t, size_t> mins;
+    for (unsigned int i = 0; i < a_points.size(); ++i) {
+        auto v1 = a_points[i], v2 = a_points[(i + 1) % a_points.size()];
         auto axis = (v2 - v1).norm().perp();
-        auto mins = axis_proj(b_poly.points, axis, b_angle);
-        auto min = get<0>(mins) - v1.dot(axis) + ray.dot(axis);
+        double proj;
+        mins = b_points.minProjection(axis, proj, mins.first);
+        auto min = proj - v1.dot(axis) + ray.dot(axis);
         if (!i || min > get<0>(res)) {
             get<0>(res) = min;
             get<1>(res) = v1;
             get<2>(res) = v2;
-            get<3>(res) = get<1>(mins);
-            get<4>(res) = get<2>(mins);
+            // Rounding can split the ends of an edge parallel to A's, so a neighbour within the collision limit ties too
+            auto n = b_points.size();
+            auto tied = mins.second;
+            if (mins.first == mins.second && n > 1) {
+                auto next = (mins.first + 1) % n, prev = (mins.first + n - 1) % n;
+                if (b_points[next].dot(axis) - proj < COLLISION_LIMIT) {
+                    tied = next;
+                }
+                else if (b_points[prev].dot(axis) - proj < COLLISION_LIMIT) {
+                    tied = prev;
+                }
+            }
+            get<3>(res) = b_points[mins.first];
+            get<4>(res) = b_points[tied];
+            // A tied edge must be in B's winding order for the sign of the distance. The edge from B's last point to
+            // its first comes out of minProjection the other way round.
+            if (tied != mins.first) {
+                windingEdge(b_points, mins.first, tied, get<3>(res), get<4>(res));
+            }
         }
     }
     return res;
 }
 
-DistanceResult shyphe::distanceBetweenPolygonPolygon(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body) {
-    const auto& a_poly = dynamic_cast<const Polygon&>(a);
-    const auto& b_poly = dynamic_cast<const Polygon&>(b);
-
-    auto apos = a_body.position() + a_poly.position.rotate(a_body.angle());
-    auto bpos = b_body.position() + b_poly.position.rotate(b_body.angle());
+static DistanceResult distanceBetweenPolygonPolygonSAT(const RotatedPoints& a_points, const Vec& apos, const RotatedPoints& b_points, const Vec& bpos) {
     auto ray = bpos - apos;
     DistanceResult dist;
 
     // Use SAT to find closest edges, then find closest distance
-    auto a_res = axis_proj_poly(a_poly, b_poly, ray, a_body.angle(), b_body.angle());
-    auto b_res = axis_proj_poly(b_poly, a_poly, -ray, b_body.angle(), a_body.angle());
+    auto a_res = axis_proj_poly(a_points, b_points, ray);
+    auto b_res = axis_proj_poly(b_points, a_points, -ray);
     Vec a1, a2, b1, b2, plane_norm;
     double dummy;
 
@@ -256,6 +470,97 @@ DistanceResult shyphe::distanceBetweenPolygonPolygon(const Shape& a, const Body&
     return dist;
 }
 
+// If an edge next to vertex index is parallel to the edge l1 to l2, as SAT sees it (the same projection onto the
+// edge's normal), set e1 and e2 to its ends
+static bool parallelNeighbour(const RotatedPoints& points, unsigned int index, const Vec& l1, const Vec& l2, Vec& e1, Vec& e2) {
+    auto axis = (l2 - l1).norm().perp();
+    auto proj = points[index].dot(axis);
+    auto before = (index + points.size() - 1) % points.size(), after = (index + 1) % points.size();
+    if (points[before].dot(axis) == proj) {
+        e1 = points[before];
+        e2 = points[index];
+        return true;
+    }
+    if (points[after].dot(axis) == proj) {
+        e1 = points[index];
+        e2 = points[after];
+        return true;
+    }
+    return false;
+}
+
+// Distance between the closest features found by GJK, measured as the SAT path measures its closest edges. False if
+// the features are not a vertex or an edge of each polygon.
+static bool distanceBetweenFeatures(const Simplex& simplex, const RotatedPoints& a_points, const Vec& apos,
+                                    const RotatedPoints& b_points, const Vec& bpos, DistanceResult& dist) {
+    const auto& v1 = simplex.vertices[0];
+    if (simplex.count == 1) {
+        auto a_point = apos + a_points[v1.a], b_point = bpos + b_points[v1.b];
+        auto ray = b_point - a_point;
+        dist = {ray.abs(), a_point, b_point, ray.norm()};
+        return true;
+    }
+    const auto& v2 = simplex.vertices[1];
+    Vec a1, a2, b1, b2;
+    // A vertex against an edge may be part of a pair of parallel edges, which the simplex cannot tell apart
+    if (v1.a == v2.a) {
+        if (!windingEdge(b_points, v1.b, v2.b, b1, b2)) {
+            return false;
+        }
+        a1 = a2 = a_points[v1.a];
+        parallelNeighbour(a_points, v1.a, b1, b2, a1, a2);
+    }
+    else if (v1.b == v2.b) {
+        if (!windingEdge(a_points, v1.a, v2.a, a1, a2)) {
+            return false;
+        }
+        b1 = b2 = b_points[v1.b];
+        parallelNeighbour(b_points, v1.b, a1, a2, b1, b2);
+    }
+    else if (!windingEdge(a_points, v1.a, v2.a, a1, a2) || !windingEdge(b_points, v1.b, v2.b, b1, b2)) {
+        return false;
+    }
+
+    if (a1 == a2) {
+        updateMinimumDistance(dist, apos + a1, b1, b2, bpos, 0, true, false);
+    }
+    else if (b1 == b2) {
+        updateMinimumDistance(dist, bpos + b1, a1, a2, apos, 0, true, true);
+    }
+    else {
+        auto n = updateMinimumDistance(dist, apos + a1, b1, b2, bpos, 0, true, false);
+        n = updateMinimumDistance(dist, apos + a2, b1, b2, bpos, n, false, false);
+        n = updateMinimumDistance(dist, bpos + b1, a1, a2, apos, n, false, true);
+        n = updateMinimumDistance(dist, bpos + b2, a1, a2, apos, n, false, true);
+        dist.a_point /= n;
+        dist.b_point /= n;
+    }
+    return true;
+}
+
+DistanceResult shyphe::distanceBetweenPolygonPolygon(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                     DistanceCache& cache) {
+    const auto& a_poly = static_cast<const Polygon&>(a);
+    const auto& b_poly = static_cast<const Polygon&>(b);
+
+    // Rotate each polygon once, the buffers are reused between queries
+    thread_local RotatedPoints a_points, b_points;
+    a_points.assign(a_poly.points, a_body.rot);
+    b_points.assign(b_poly.points, b_body.rot);
+
+    auto apos = a_body.position + a_points.rotate(a_poly.position);
+    auto bpos = b_body.position + b_points.rotate(b_poly.position);
+
+    // GJK finds the closest features of separated polygons. It cannot measure overlaps, or reliably pick features
+    // at contact distances, so those go through SAT.
+    DistanceResult dist;
+    if (gjkDistance(a_points, apos, b_points, bpos, COLLISION_LIMIT, cache.simplex)
+        && distanceBetweenFeatures(cache.simplex, a_points, apos, b_points, bpos, dist)) {
+        return dist;
+    }
+    return distanceBetweenPolygonPolygonSAT(a_points, apos, b_points, bpos);
+}
+
 inline double square(double x) {
     return x * x;
 }
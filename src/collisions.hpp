@@ -25,8 +25,10 @@
 namespace shyphe {
     class Shape;
     class Body;
+    struct KinematicState;
     class Circle;
     class Polygon;
+    struct DistanceCache;
 
     struct DistanceResult {
         constexpr DistanceResult(double dist, Vec a, Vec b, Vec norm) : distance(dist), a_point(a), b_point(b), normal(norm) {
@@ -51,14 +53,52 @@ namespace shyphe {
         double time = -1;
         Vec touch_point = {0, 0};
         Vec normal = {0, 0};
+        // Distance queries spent finding the result
+        unsigned int iterations = 0;
+        // Shape pairs Body::collide ruled out before the narrowphase
+        unsigned int culled = 0;
     };
 
-    CollisionTimeResult collideShapes(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body, double end_time, bool ignore_initial);
+    enum class TOISolver {
+        // Advance by a bound on the closing speed until touching, never steps over a contact
+        conservative,
+        // Tighter per-step bounds, plus a secant search once a penetrating time is known. Can step over a
+        // contact that starts and ends between two samples.
+        bilateral
+    };
+
+    struct TOIStats {
+        unsigned long pairs = 0, iterations = 0, max_iterations = 0, culled = 0;
+
+        inline void add(unsigned long pair_iterations, unsigned long pair_culled) {
+            ++pairs;
+            iterations += pair_iterations;
+            culled += pair_culled;
+            if (pair_iterations > max_iterations) {
+                max_iterations = pair_iterations;
+            }
+        }
+    };
 
-    DistanceResult distanceBetweenCircleCircle(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body);
-    DistanceResult distanceBetweenCirclePolygon(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body);
-    DistanceResult distanceBetweenPolygonCircle(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body);
-    DistanceResult distanceBetweenPolygonPolygon(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body);
+    // The cache is kept between the queries one time of impact search makes on a pair of shapes. It is opaque, only
+    // the built-in polygon distance uses it, so other distance functions can ignore it.
+    typedef DistanceResult (*DistanceFunction)(const Shape&, const KinematicState&, const Shape&, const KinematicState&, DistanceCache&);
+
+    // Not thread safe, register new shape kinds and their distance functions before using them in a world
+    unsigned int registerShapeKind();
+    void registerDistanceFunction(unsigned int a_kind, unsigned int b_kind, DistanceFunction func);
+
+    CollisionTimeResult collideShapes(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body, double end_time, bool ignore_initial,
+                                      TOISolver solver=TOISolver::conservative);
+
+    DistanceResult distanceBetweenCircleCircle(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                               DistanceCache& cache);
+    DistanceResult distanceBetweenCirclePolygon(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                DistanceCache& cache);
+    DistanceResult distanceBetweenPolygonCircle(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                DistanceCache& cache);
+    DistanceResult distanceBetweenPolygonPolygon(const Shape& a, const KinematicState& a_body, const Shape& b, const KinematicState& b_body,
+                                                 DistanceCache& cache);
     DistanceResult distanceBetween(const Shape& a, const Body& a_body, const Shape& b, const Body& b_body);
 
     struct CollisionResult {
@@ -0,0 +1,131 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "gjk.hpp"
+
+using namespace std;
+using namespace shyphe;
+
+// Each support point is new, so this only guards against rounding
+const unsigned int MAX_GJK_ITERATIONS = 64;
+
+// Reduce the simplex to the smallest part containing the point closest to the origin, which is returned.
+// Leaves three vertices if the origin is inside.
+static Vec solveSimplex(Simplex& simplex) {
+    auto& v = simplex.vertices;
+    if (simplex.count == 1) {
+        return v[0].w;
+    }
+    if (simplex.count == 2) {
+        auto e12 = v[1].w - v[0].w;
+        auto d12_1 = v[1].w.dot(e12), d12_2 = -v[0].w.dot(e12);
+        if (d12_2 <= 0) {
+            simplex.count = 1;
+            return v[0].w;
+        }
+        if (d12_1 <= 0) {
+            v[0] = v[1];
+            simplex.count = 1;
+            return v[0].w;
+        }
+        return (d12_1 * v[0].w + d12_2 * v[1].w) / (d12_1 + d12_2);
+    }
+
+    // Barycentric coordinates of the origin on each edge, and in the triangle
+    auto e12 = v[1].w - v[0].w, e13 = v[2].w - v[0].w, e23 = v[2].w - v[1].w;
+    auto d12_1 = v[1].w.dot(e12), d12_2 = -v[0].w.dot(e12);
+    auto d13_1 = v[2].w.dot(e13), d13_2 = -v[0].w.dot(e13);
+    auto d23_1 = v[2].w.dot(e23), d23_2 = -v[1].w.dot(e23);
+    auto n123 = e12.cross(e13);
+    auto d123_1 = n123 * v[1].w.cross(v[2].w);
+    auto d123_2 = n123 * v[2].w.cross(v[0].w);
+    auto d123_3 = n123 * v[0].w.cross(v[1].w);
+
+    if (d12_2 <= 0 && d13_2 <= 0) {
+        simplex.count = 1;
+        return v[0].w;
+    }
+    if (d12_1 > 0 && d12_2 > 0 && d123_3 <= 0) {
+        simplex.count = 2;
+        return (d12_1 * v[0].w + d12_2 * v[1].w) / (d12_1 + d12_2);
+    }
+    if (d13_1 > 0 && d13_2 > 0 && d123_2 <= 0) {
+        v[1] = v[2];
+        simplex.count = 2;
+        return (d13_1 * v[0].w + d13_2 * v[1].w) / (d13_1 + d13_2);
+    }
+    if (d12_1 <= 0 && d23_2 <= 0) {
+        v[0] = v[1];
+        simplex.count = 1;
+        return v[0].w;
+    }
+    if (d13_1 <= 0 && d23_1 <= 0) {
+        v[0] = v[2];
+        simplex.count = 1;
+        return v[0].w;
+    }
+    if (d23_1 > 0 && d23_2 > 0 && d123_1 <= 0) {
+        v[0] = v[2];
+        simplex.count = 2;
+        return (d23_2 * v[0].w + d23_1 * v[1].w) / (d23_1 + d23_2);
+    }
+    return {};
+}
+
+bool shyphe::gjkDistance(const RotatedPoints& a_points, const Vec& apos, const RotatedPoints& b_points, const Vec& bpos,
+                         double tolerance, Simplex& simplex) {
+    auto ray = bpos - apos;
+    auto vertex = [&](unsigned int a, unsigned int b) -> SimplexVertex {
+        return {ray + b_points[b] - a_points[a], a, b};
+    };
+
+    // Rebuild the warm start at the current positions, dropping anything which no longer fits the polygons
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < simplex.count; ++i) {
+        const auto& old = simplex.vertices[i];
+        if (old.a < a_points.size() && old.b < b_points.size()) {
+            simplex.vertices[count++] = vertex(old.a, old.b);
+        }
+    }
+    if (!count) {
+        simplex.vertices[count++] = vertex(a_points.support(ray), b_points.support(-ray));
+    }
+    simplex.count = count;
+
+    for (unsigned int iteration = 0; iteration < MAX_GJK_ITERATIONS; ++iteration) {
+        auto v = solveSimplex(simplex);
+        if (simplex.count == 3 || v.squared() < tolerance * tolerance) {
+            return false;
+        }
+        // The simplex is next to the new support points, so walk to them from there
+        const auto& near = simplex.vertices[0];
+        auto w = vertex(a_points.support(v, near.a), b_points.support(-v, near.b));
+        // No closer support point, so v is the closest point
+        if (v.squared() - v.dot(w.w) <= 1e-12 * v.squared()) {
+            return true;
+        }
+        for (unsigned int i = 0; i < simplex.count; ++i) {
+            if (simplex.vertices[i].a == w.a && simplex.vertices[i].b == w.b) {
+                return true;
+            }
+        }
+        simplex.vertices[simplex.count++] = w;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_GJK_HPP
+#define SHYPHE_GJK_HPP
+
+#include "vec.hpp"
+#include "projection.hpp"
+
+namespace shyphe {
+    // Point of the Minkowski difference B - A, from point a of A and point b of B
+    struct SimplexVertex {
+        Vec w;
+        unsigned int a, b;
+    };
+
+    // GJK's simplex. After a query it holds the closest features, and it can be passed to the next query on the same
+    // pair as a warm start.
+    struct Simplex {
+        SimplexVertex vertices[3];
+        unsigned int count = 0;
+    };
+
+    // Closest features of the convex polygons a_points + apos and b_points + bpos, left in simplex (a vertex or an
+    // edge of the Minkowski difference). Returns false if the polygons are within tolerance of each other or overlap.
+    bool gjkDistance(const RotatedPoints& a_points, const Vec& apos, const RotatedPoints& b_points, const Vec& bpos,
+                     double tolerance, Simplex& simplex);
+}
+
+#endif // SHYPHE_GJK_HPP
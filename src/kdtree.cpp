@@ -0,0 +1,73 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "kdtree.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+using namespace shyphe;
+
+void KDTree::build(const vector<Vec>& points_) {
+    points = points_;
+    order.resize(points.size());
+    iota(order.begin(), order.end(), 0);
+    _build(0, order.size(), true);
+}
+
+void KDTree::_build(size_t begin, size_t end, bool x_axis) {
+    if (end - begin < 2) {
+        return;
+    }
+    auto mid = begin + (end - begin) / 2;
+    nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                [this, x_axis](unsigned int a, unsigned int b) {
+                    return x_axis ? points[a].x < points[b].x : points[a].y < points[b].y;
+                });
+    _build(begin, mid, !x_axis);
+    _build(mid + 1, end, !x_axis);
+}
+
+void KDTree::query(const Vec& center, double radius, vector<unsigned int>& result) const {
+    _query(0, order.size(), true, center, radius, result);
+}
+
+void KDTree::_query(size_t begin, size_t end, bool x_axis, const Vec& center, double radius,
+                    vector<unsigned int>& result) const {
+    while (begin < end) {
+        auto mid = begin + (end - begin) / 2;
+        const auto& point = points[order[mid]];
+        if ((point - center).squared() <= radius * radius) {
+            result.push_back(order[mid]);
+        }
+        auto diff = x_axis ? center.x - point.x : center.y - point.y;
+        // Recurse into one side and loop on the other
+        if (diff <= radius) {
+            if (diff >= -radius) {
+                _query(mid + 1, end, !x_axis, center, radius, result);
+            }
+            end = mid;
+        }
+        else {
+            begin = mid + 1;
+        }
+        x_axis = !x_axis;
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_KDTREE_HPP
+#define SHYPHE_KDTREE_HPP
+
+#include <vector>
+#include "vec.hpp"
+
+namespace shyphe {
+    // Static 2D k-d tree over a set of points, stored implicitly: each range of the index array is split at its
+    // median, alternating between x and y.
+    class KDTree {
+    public:
+        void build(const std::vector<Vec>& points_);
+        // Appends the indices of all the points within radius of center, in no particular order
+        void query(const Vec& center, double radius, std::vector<unsigned int>& result) const;
+
+        inline std::size_t size() const {
+            return points.size();
+        }
+    private:
+        std::vector<Vec> points;
+        std::vector<unsigned int> order;
+
+        void _build(std::size_t begin, std::size_t end, bool x_axis);
+        void _query(std::size_t begin, std::size_t end, bool x_axis, const Vec& center, double radius,
+                    std::vector<unsigned int>& result) const;
+    };
+}
+
+#endif // SHYPHE_KDTREE_HPP
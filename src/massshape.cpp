@@ -23,7 +23,7 @@ using namespace std;
 using namespace shyphe;
 
 MassShape::MassShape(double moment_of_inertia_/*=1*/, double mass_/*=0*/, const Vec& position_/*={}*/, double radar_cross_section/*=0*/,
-                     double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : Shape(mass_,
+                     double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : Shape(MASS_SHAPE_KIND, mass_,
                                                                                            position_,
                                                                                            radar_cross_section,
                                                                                            radar_emissions,
@@ -45,15 +45,11 @@ double MassShape::momentOfInertia() const {
 }
 
 // LCOV_EXCL_START
-type_index MassShape::shape_type() const {
-    return {typeid(MassShape)};
-}
-
 double MassShape::boundingRadius() const {
     return 0;
 }
 
-AABB MassShape::aabb(double /*angle*/) const {
+AABB MassShape::aabb(const Rot& /*rot*/) const {
     return {0, 0, 0, 0};
 }
 // LCOV_EXCL_STOP
@@ -0,0 +1,128 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "pairflags.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace shyphe;
+
+static size_t pairHash(unsigned long low, unsigned long high) {
+    // splitmix64 finaliser
+    unsigned long long x = low * 0x9e3779b97f4a7c15ull ^ high;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+size_t PairFlags::_find(unsigned long low, unsigned long high) const {
+    // Index of the slot holding the pair, or of the empty slot where it would go
+    auto mask = slots.size() - 1;
+    auto index = pairHash(low, high) & mask;
+    while (slots[index].used && (slots[index].low != low || slots[index].high != high)) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+bool PairFlags::get(unsigned long a, unsigned long b) const {
+    if (!used) {
+        return false;
+    }
+    return slots[_find(min(a, b), max(a, b))].used;
+}
+
+void PairFlags::set(unsigned long a, unsigned long b, bool flag) {
+    if (!flag) {
+        if (used) {
+            auto index = _find(min(a, b), max(a, b));
+            if (slots[index].used) {
+                _erase(index);
+                _shrink();
+            }
+        }
+        return;
+    }
+    // Keep the load factor under a half so probe runs stay short
+    if ((used + 1) * 2 > slots.size()) {
+        _rehash(max<size_t>(16, slots.size() * 2));
+    }
+    auto& slot = slots[_find(min(a, b), max(a, b))];
+    if (!slot.used) {
+        slot = {min(a, b), max(a, b), true};
+        ++used;
+    }
+}
+
+void PairFlags::removeId(unsigned long id) {
+    // Erasing shifts later slots of the probe run back, possibly into this one, so look at it again
+    for (size_t i = 0; i < slots.size() && used;) {
+        if (slots[i].used && (slots[i].low == id || slots[i].high == id)) {
+            _erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+    _shrink();
+}
+
+void PairFlags::clear() {
+    slots.clear();
+    used = 0;
+}
+
+void PairFlags::_erase(size_t index) {
+    // Backward shift deletion: move the rest of the probe run into the hole, unless that would put a pair before
+    // its home slot, so lookups never need tombstones
+    auto mask = slots.size() - 1;
+    auto hole = index;
+    for (auto next = (hole + 1) & mask; slots[next].used; next = (next + 1) & mask) {
+        auto home = pairHash(slots[next].low, slots[next].high) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+    }
+    slots[hole].used = false;
+    --used;
+}
+
+void PairFlags::_shrink() {
+    // Give back space once most of the pairs are gone
+    auto capacity = slots.size();
+    while (capacity > 16 && used * 8 < capacity) {
+        capacity /= 2;
+    }
+    if (capacity != slots.size()) {
+        _rehash(capacity);
+    }
+}
+
+void PairFlags::_rehash(size_t capacity) {
+    vector<Slot> old;
+    swap(old, slots);
+    slots.resize(capacity);
+    for (const auto& slot : old) {
+        if (slot.used) {
+            slots[_find(slot.low, slot.high)] = slot;
+        }
+    }
+}
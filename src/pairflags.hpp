@@ -0,0 +1,54 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_PAIRFLAGS_HPP
+#define SHYPHE_PAIRFLAGS_HPP
+
+#include <vector>
+
+namespace shyphe {
+    // Boolean flag per unordered pair of ids, in an open addressing hash table with linear probing. Only the pairs
+    // set to true are stored, so the table follows the number of flagged pairs.
+    class PairFlags {
+    public:
+        bool get(unsigned long a, unsigned long b) const;
+        void set(unsigned long a, unsigned long b, bool flag);
+        void removeId(unsigned long id);
+        void clear();
+
+        inline std::size_t size() const {
+            return used;
+        }
+    private:
+        struct Slot {
+            unsigned long low, high;
+            bool used;
+        };
+
+        std::vector<Slot> slots;
+        std::size_t used = 0;
+
+        std::size_t _find(unsigned long low, unsigned long high) const;
+        void _erase(std::size_t index);
+        void _shrink();
+        void _rehash(std::size_t capacity);
+    };
+}
+
+#endif // SHYPHE_PAIRFLAGS_HPP
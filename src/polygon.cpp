@@ -24,7 +24,7 @@ using namespace std;
 using namespace shyphe;
 
 Polygon::Polygon(const std::vector<Vec>& points_/*={}*/, double mass_/*=0*/, const Vec& position_/*={}*/,
-                 double radar_cross_section/*=0*/, double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : Shape(mass_, position_,
+                 double radar_cross_section/*=0*/, double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : Shape(POLYGON_KIND, mass_, position_,
                                                                                                                          radar_cross_section,
                                                                                                                          radar_emissions,
                                                                                                                          thermal_emissions),
@@ -55,12 +55,12 @@ Polygon::Polygon(const std::vector<Vec>& points_/*={}*/, double mass_/*=0*/, con
     }
 }
 
-AABB Polygon::aabb(double angle) const {
+AABB Polygon::aabb(const Rot& rot) const {
     double minx, maxx, miny, maxy;
     bool initial = true;
 
     for (const auto& point : points) {
-        auto rpoint = point.rotate(angle);
+        auto rpoint = point.rotate(rot);
         if (initial) {
             minx = maxx = rpoint.x;
         }
@@ -92,10 +92,6 @@ bool Polygon::canCollide() const {
     return true;
 }
 
-type_index Polygon::shape_type() const {
-    return {typeid(Polygon)};
-}
-
 double Polygon::boundingRadius() const {
     double br = 0;
     for (const auto& point : points) {
@@ -32,10 +32,9 @@ namespace shyphe {
         Polygon(const std::vector<Vec>& points_={}, double mass_=0, const Vec& position_={},
                 double radar_cross_section=0, double radar_emissions=0, double thermal_emissions=0);
 
-        virtual AABB aabb(double angle) const override;
+        virtual AABB aabb(const Rot& rot) const override;
         virtual Shape* clone() const override;
         virtual bool canCollide() const override;
-        virtual std::type_index shape_type() const override;
         virtual double boundingRadius() const override;
         virtual double momentOfInertia() const override;
     };
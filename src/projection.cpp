@@ -0,0 +1,127 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "projection.hpp"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace shyphe;
+
+void RotatedPoints::assign(const vector<Vec>& points, const Rot& rot) {
+    _rot = rot;
+    x.resize(points.size());
+    y.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        auto rpoint = rotate(points[i]);
+        x[i] = rpoint.x;
+        y[i] = rpoint.y;
+    }
+}
+
+pair<size_t, size_t> RotatedPoints::minProjection(const Vec& axis, double& min) const {
+    auto n = x.size();
+    dots.resize(n);
+    size_t i = 0;
+    // Multiply then add, like Vec::dot, so all the paths give the same dots
+#if defined(__AVX__)
+    auto ax = _mm256_set1_pd(axis.x), ay = _mm256_set1_pd(axis.y);
+    for (; i + 4 <= n; i += 4) {
+        auto d = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(&x[i]), ax), _mm256_mul_pd(_mm256_loadu_pd(&y[i]), ay));
+        _mm256_storeu_pd(&dots[i], d);
+    }
+#elif defined(__SSE2__)
+    auto ax = _mm_set1_pd(axis.x), ay = _mm_set1_pd(axis.y);
+    for (; i + 2 <= n; i += 2) {
+        auto d = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&x[i]), ax), _mm_mul_pd(_mm_loadu_pd(&y[i]), ay));
+        _mm_storeu_pd(&dots[i], d);
+    }
+#endif
+    for (; i < n; ++i) {
+        dots[i] = x[i] * axis.x + y[i] * axis.y;
+    }
+
+    size_t first = 0, last = 0;
+    min = dots[0];
+    for (i = 1; i < n; ++i) {
+        if (dots[i] < min) {
+            min = dots[i];
+            first = last = i;
+        }
+        else if (dots[i] == min) {
+            last = i;
+        }
+    }
+    return {first, last};
+}
+
+size_t RotatedPoints::_descend(const Vec& axis, size_t start, double& min) const {
+    auto n = x.size();
+    auto dot = [&](size_t i) {
+        return x[i] * axis.x + y[i] * axis.y;
+    };
+    // The projections of a convex polygon fall to one minimum and rise again, so walk whichever way is downhill
+    auto i = start;
+    min = dot(i);
+    auto next = (i + 1) % n;
+    auto d = dot(next);
+    if (d < min) {
+        do {
+            i = next;
+            min = d;
+            next = (i + 1) % n;
+            d = dot(next);
+        } while (d < min);
+        return i;
+    }
+    auto prev = (i + n - 1) % n;
+    d = dot(prev);
+    while (d < min) {
+        i = prev;
+        min = d;
+        prev = (i + n - 1) % n;
+        d = dot(prev);
+    }
+    return i;
+}
+
+pair<size_t, size_t> RotatedPoints::minProjection(const Vec& axis, double& min, size_t start) const {
+    auto i = _descend(axis, start, min);
+    // Only a neighbour can tie, as the polygon has no collinear points. Order them by index, like the full scan.
+    auto n = x.size();
+    auto next = (i + 1) % n, prev = (i + n - 1) % n;
+    if (x[next] * axis.x + y[next] * axis.y == min) {
+        return {std::min(i, next), std::max(i, next)};
+    }
+    if (x[prev] * axis.x + y[prev] * axis.y == min) {
+        return {std::min(i, prev), std::max(i, prev)};
+    }
+    return {i, i};
+}
+
+size_t RotatedPoints::support(const Vec& direction, size_t start/*=0*/) const {
+    double min;
+    return minProjection(-direction, min, start).first;
+}
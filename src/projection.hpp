@@ -0,0 +1,65 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_PROJECTION_HPP
+#define SHYPHE_PROJECTION_HPP
+
+#include <vector>
+#include <utility>
+
+#include "vec.hpp"
+
+namespace shyphe {
+    // Rotated points, kept as separate x and y arrays so they can be projected several at a time
+    class RotatedPoints {
+    public:
+        void assign(const std::vector<Vec>& points, const Rot& rot);
+
+        // Rotate another vector by the same angle
+        inline Vec rotate(const Vec& v) const {
+            return v.rotate(_rot);
+        }
+
+        inline Vec operator[](std::size_t index) const {
+            return {x[index], y[index]};
+        }
+
+        inline std::size_t size() const {
+            return x.size();
+        }
+
+        // Smallest dot product of the points with axis, and the first and last points which have it
+        std::pair<std::size_t, std::size_t> minProjection(const Vec& axis, double& min) const;
+
+        // As above, but walks downhill from point start rather than projecting every point. The points must be a
+        // convex polygon, and a start near the answer (such as the answer for a nearby axis) makes it O(1).
+        std::pair<std::size_t, std::size_t> minProjection(const Vec& axis, double& min, std::size_t start) const;
+
+        // First point furthest along direction, walking from point start. The points must be a convex polygon.
+        std::size_t support(const Vec& direction, std::size_t start=0) const;
+    private:
+        std::size_t _descend(const Vec& axis, std::size_t start, double& min) const;
+
+        Rot _rot;
+        std::vector<double> x, y;
+        mutable std::vector<double> dots;
+    };
+}
+
+#endif // SHYPHE_PROJECTION_HPP
@@ -45,6 +45,10 @@ string aabb_repr(const AABB& aabb) {
     return ss.str();
 }
 
+AABB shape_aabb(const Shape& shape, double angle) {
+    return shape.aabb(Rot(angle));
+}
+
 tuple<CollisionTimeResult, shared_ptr<Shape>, shared_ptr<Shape>> body_collide(Body& a, Body* b, double et, bool i) {
     CollisionTimeResult ctr;
     Shape* s1;
@@ -56,6 +60,12 @@ tuple<CollisionTimeResult, shared_ptr<Shape>, shared_ptr<Shape>> body_collide(Bo
     return {ctr, s1->shared_from_this(), s2->shared_from_this()};
 }
 
+template<class T, class V, V T::*member> void set_shape_member(T& shape, const V& value) {
+    // Bodies cache their mass properties, so they need to be told about changes
+    shape.*member = value;
+    shape.changed();
+}
+
 void wrap_body() {
     // Note: All the Vec properties have to return copies to preserve immutability
     SharedConverter<Body>();
@@ -74,9 +84,12 @@ void wrap_body() {
         .add_property("local_torque", &Body::localTorque)
         .add_property("global_torque", &Body::globalTorque)
         .add_property("side", &Body::side)
+        .add_property("notify_collisions", &Body::notifyCollisions, &Body::setNotifyCollisions)
+        .add_property("strips_per_second", &Body::stripsPerSecond, &Body::setStripsPerSecond)
         .add_property("sensor_view", make_function(&Body::sensorView, python::return_internal_reference<>()))
         .add_property("mass", &Body::mass)
         .add_property("moment_of_inertia", &Body::momentOfInertia)
+        .add_property("bounding_radius", &Body::boundingRadius)
         .add_property("max_sensor_range", &Body::maxSensorRange)
         .add_property("shapes", python::make_function(&Body::shapes, python::return_internal_reference<>()))
         .add_property("sensors", python::make_function(&Body::sensors, python::return_internal_reference<>()))
@@ -145,13 +158,13 @@ void wrap_body() {
 
     SharedConverter<Shape>();
     python::class_<Shape, boost::noncopyable, py_ptr<Shape>>("Shape", python::no_init)
-        .def_readwrite("mass", &Shape::mass)
+        .add_property("mass", python::make_getter(&Shape::mass), set_shape_member<Shape, double, &Shape::mass>)
         .add_property("position",
              python::make_getter(&Shape::position, python::return_value_policy<python::return_by_value>()),
-             python::make_setter(&Shape::position))
+             set_shape_member<Shape, Vec, &Shape::position>)
         .add_property("moment_of_inertia", &Shape::momentOfInertia)
         .def_readwrite("signature", &Shape::signature)
-        .def("aabb", &Shape::aabb)
+        .def("aabb", shape_aabb)
         .def("bounding_radius", &Shape::boundingRadius)
         .def("can_collide", &Shape::canCollide)
         .def("clone", &Shape::clone, python::return_value_policy<python::manage_new_object>());
@@ -162,7 +175,7 @@ void wrap_body() {
                                                                           python::arg("radar_cross_section")=0,
                                                                           python::arg("radar_emissions")=0,
                                                                           python::arg("thermal_emissions")=0)))
-        .def_readwrite("radius", &Circle::radius);
+        .add_property("radius", python::make_getter(&Circle::radius), set_shape_member<Circle, double, &Circle::radius>);
     python::class_<MassShape, boost::noncopyable, python::bases<Shape>, py_ptr<MassShape>>("MassShape",
         python::init<double, double, const Vec&, double, double, double>((python::arg("moment_of_inertia")=1,
                                                                           python::arg("mass")=0,
@@ -170,7 +183,8 @@ void wrap_body() {
                                                                           python::arg("radar_cross_section")=0,
                                                                           python::arg("radar_emissions")=0,
                                                                           python::arg("thermal_emissions")=0)))
-        .def_readwrite("moment_of_inertia", &MassShape::moment_of_inertia);
+        .add_property("moment_of_inertia", python::make_getter(&MassShape::moment_of_inertia),
+             set_shape_member<MassShape, double, &MassShape::moment_of_inertia>);
     python::class_<Polygon, boost::noncopyable, python::bases<Shape>, py_ptr<Polygon>>("Polygon",
         python::init<vector<Vec>, double, const Vec&, double, double, double>((python::arg("points")=python::list(),
                                                                                python::arg("mass")=0,
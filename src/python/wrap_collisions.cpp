@@ -26,7 +26,12 @@ using namespace std;
 using namespace shyphe;
 
 void wrap_collisions() {
-    python::def("collide_shapes", collideShapes);
+    python::enum_<TOISolver>("TOISolver")
+        .value("conservative", TOISolver::conservative)
+        .value("bilateral", TOISolver::bilateral);
+    python::def("collide_shapes", collideShapes, (python::arg("a"), python::arg("a_body"), python::arg("b"), python::arg("b_body"),
+                                                  python::arg("end_time"), python::arg("ignore_initial"),
+                                                  python::arg("solver")=TOISolver::conservative));
     python::def("distance_between", distanceBetween);
     python::def("collision_result", collisionResult);
     python::class_<DistanceResult>("DistanceResult", python::init<double, Vec, Vec, Vec>())
@@ -40,7 +45,14 @@ void wrap_collisions() {
     python::class_<CollisionTimeResult>("CollisionTimeResult", python::init<double, Vec, Vec>())
         .def_readonly("time", &CollisionTimeResult::time)
         .def_readonly("touch_point", &CollisionTimeResult::touch_point)
-        .def_readonly("normal", &CollisionTimeResult::normal);
+        .def_readonly("normal", &CollisionTimeResult::normal)
+        .def_readonly("iterations", &CollisionTimeResult::iterations)
+        .def_readonly("culled", &CollisionTimeResult::culled);
+    python::class_<TOIStats>("TOIStats")
+        .def_readonly("pairs", &TOIStats::pairs)
+        .def_readonly("iterations", &TOIStats::iterations)
+        .def_readonly("max_iterations", &TOIStats::max_iterations)
+        .def_readonly("culled", &TOIStats::culled);
     python::class_<CollisionParameters>("CollisionParameters", python::init<double>())
         .def_readwrite("restitution", &CollisionParameters::restitution);
 }
@@ -108,6 +108,13 @@ python::object vec_hash(const Vec& v) {
 
 void wrap_vec() {
     Vec_from_tuple();
+    python::class_<Rot>("Rot", python::init<double>())
+        .def(python::init<double, double>())
+        .def_readonly("c", &Rot::c)
+        .def_readonly("s", &Rot::s)
+        .def("angle", &Rot::angle)
+        .def("inverse", &Rot::inverse)
+        .def(op::self * op::self);
     // Note: inplace operators are not wrapped so vectors are immutable in python. As python does not copy objects, this makes everything safer
     python::class_<Vec>("Vec", python::init<double, double>())
         .def(python::init<>())
@@ -137,7 +144,8 @@ void wrap_vec() {
         .def("rej", &Vec::rej)
         .def("from_bearing", &Vec::fromBearing)
         .staticmethod("from_bearing")
-        .def("rotate", &Vec::rotate)
+        .def("rotate", static_cast<Vec (Vec::*)(double) const>(&Vec::rotate))
+        .def("rotate", static_cast<Vec (Vec::*)(const Rot&) const>(&Vec::rotate))
         .def(op::self + python::other<Vec>())
         .def(op::self - python::other<Vec>())
         .def(python::other<Vec>() + op::self)
@@ -25,8 +25,77 @@
 using namespace std;
 using namespace shyphe;
 
+// Flat buffer of count * width doubles, filled in one pass by write. Returned as a memoryview, so
+// numpy.frombuffer can use it without copying.
+template <class Writer> python::object double_array(size_t count, size_t width, Writer write) {
+    auto size = count * width * sizeof(double);
+    python::object buffer(python::handle<>(PyByteArray_FromStringAndSize(nullptr, size)));
+    write(reinterpret_cast<double*>(PyByteArray_AS_STRING(buffer.ptr())));
+    python::object view(python::handle<>(PyMemoryView_FromObject(buffer.ptr())));
+    return view.attr("cast")("d");
+}
+
+template <class Writer> python::object body_array(const World& world, size_t width, Writer write) {
+    return double_array(world.bodies().size(), width, write);
+}
+
+// Each event is 9 doubles: the indexes of a and b in bodies (-1 if removed during the step), time, touch
+// point x and y, normal x and y, impulse x and y
+python::object world_step(World& world, const CollisionParameters& params, python::object callback) {
+    vector<CollisionEvent> events;
+    if (callback.is_none()) {
+        events = world.step(params);
+    }
+    else {
+        events = world.step(params, [&callback](const UnresolvedCollision& collision, ResolvedCollision& a, ResolvedCollision& b) {
+            // The callback gets copies it may keep, changes to their impulses are copied back. None counts as true.
+            python::object py_a(a), py_b(b);
+            python::object result = callback(collision, py_a, py_b);
+            a = python::extract<ResolvedCollision&>(py_a);
+            b = python::extract<ResolvedCollision&>(py_b);
+            return result.is_none() || python::extract<bool>(result)();
+        });
+    }
+    return double_array(events.size(), 9, [&events](double* out) {
+        for (const auto& event : events) {
+            *out++ = event.a;
+            *out++ = event.b;
+            *out++ = event.time;
+            *out++ = event.touch_point.x;
+            *out++ = event.touch_point.y;
+            *out++ = event.normal.x;
+            *out++ = event.normal.y;
+            *out++ = event.impulse.x;
+            *out++ = event.impulse.y;
+        }
+    });
+}
+
+python::object world_positions(const World& world) {
+    return body_array(world, 2, [&world](double* out) { world.writePositions(out); });
+}
+
+python::object world_velocities(const World& world) {
+    return body_array(world, 2, [&world](double* out) { world.writeVelocities(out); });
+}
+
+python::object world_angles(const World& world) {
+    return body_array(world, 1, [&world](double* out) { world.writeAngles(out); });
+}
+
+python::object world_aabbs(const World& world, double time) {
+    return body_array(world, 4, [&world, time](double* out) { world.writeAABBs(out, time); });
+}
+
 void wrap_world() {
-    python::class_<World>("World", python::init<double>())
+    python::enum_<BroadphaseType>("BroadphaseType")
+        .value("sat_axes", BroadphaseType::sat_axes)
+        .value("aabb_tree", BroadphaseType::aabb_tree)
+        .value("spatial_hash", BroadphaseType::spatial_hash);
+    python::class_<World, boost::noncopyable>("World",
+        python::init<double, BroadphaseType, double>((python::arg("frame_time")=1,
+                                                      python::arg("broadphase")=BroadphaseType::sat_axes,
+                                                      python::arg("cell_size")=0)))
         .def("add_body", &World::addBody)
         .def("remove_body", &World::removeBody)
         .def("begin_frame", &World::beginFrame)
@@ -35,7 +104,15 @@ void wrap_world() {
         .def("calculate_collision", &World::calculateCollision)
         .def("finished_collision", &World::finishedCollision)
         .def("has_next_collision", &World::hasNextCollision)
-        .add_property("bodies", python::make_function(&World::bodies, python::return_internal_reference<>()));
+        .def("step", world_step, (python::arg("params"), python::arg("callback")=python::object()))
+        .def("positions", world_positions)
+        .def("velocities", world_velocities)
+        .def("angles", world_angles)
+        .def("aabbs", world_aabbs, (python::arg("time")=0))
+        .add_property("bodies", python::make_function(&World::bodies, python::return_internal_reference<>()))
+        .add_property("threads", &World::threads, &World::setThreads)
+        .add_property("toi_solver", &World::toiSolver, &World::setTOISolver)
+        .add_property("toi_stats", python::make_function(&World::toiStats, python::return_value_policy<python::copy_const_reference>()));
     python::class_<UnresolvedCollision>("UnresolvedCollision", python::no_init)//, python::init<Body*, Body*, Shape*, Shape*, double, Vec, Vec>())
         .def_readonly("a", &UnresolvedCollision::a)
         .def_readonly("b", &UnresolvedCollision::b)
@@ -24,72 +24,254 @@
 using namespace std;
 using namespace shyphe;
 
-void SATAxes::reset(int reserve_hint)
-{
-    x_axis.clear();
-    y_axis.clear();
-
-    if (reserve_hint) {
-        x_axis.reserve(reserve_hint);
-        y_axis.reserve(reserve_hint);
+inline double shadowPosition(const AABB& aabb, int axis_number, bool start) {
+    if (axis_number) {
+        return start ? aabb.min_y : aabb.max_y;
     }
+    return start ? aabb.min_x : aabb.max_x;
+}
+
+inline bool shadowBefore(const SATShadow& a, const SATShadow& b) {
+    // Starts go before ends at the same position, so touching bodies count as overlapping
+    return a.position < b.position || (a.position == b.position && a.start && !b.start);
 }
 
-void SATAxes::addBody(Body* body, double time) {
+void SATAxes::updateBody(Body* body, double time) {
     auto aabb = body->position() + body->aabb(time);
 
-    auto cmp = [](const SATShadow& a, const SATShadow& b){return a.position < b.position;};
+    auto iter = body_proxies.find(body);
+    if (iter == body_proxies.end()) {
+        unsigned int proxy_index;
+        if (free_proxies.size()) {
+            proxy_index = free_proxies.back();
+            free_proxies.pop_back();
+            proxies[proxy_index].body = body;
+            proxies[proxy_index].aabb = aabb;
+            proxies[proxy_index].pending = true;
+        }
+        else {
+            proxy_index = proxies.size();
+            proxies.push_back({body, aabb, {}, {}, true});
+        }
+        body_proxies[body] = proxy_index;
+        // Inserting one at a time costs up to the length of the axes each, so wait and see how many there are
+        pending_proxies.push_back(proxy_index);
+        return;
+    }
 
-    auto tmp = SATShadow{aabb.min_x, true, body};
-    auto minpos = upper_bound(x_axis.begin(), x_axis.end(), tmp, cmp);
-    x_axis.insert(minpos, move(tmp));
+    auto& proxy = proxies[iter->second];
+    if (proxy.pending) {
+        proxy.aabb = aabb;
+        return;
+    }
+    auto old_aabb = proxy.aabb;
+    proxy.aabb = aabb;
+    for (int axis_number = 0; axis_number < 2; ++axis_number) {
+        auto& axis = axes[axis_number];
+        axis[proxy.shadows[axis_number][0]].position = shadowPosition(aabb, axis_number, true);
+        axis[proxy.shadows[axis_number][1]].position = shadowPosition(aabb, axis_number, false);
+        // If the end moves right it has to go first, otherwise the start could get stuck behind it
+        if (shadowPosition(aabb, axis_number, false) > shadowPosition(old_aabb, axis_number, false)) {
+            _moveShadow(axis_number, proxy.shadows[axis_number][1]);
+            _moveShadow(axis_number, proxy.shadows[axis_number][0]);
+        }
+        else {
+            _moveShadow(axis_number, proxy.shadows[axis_number][0]);
+            _moveShadow(axis_number, proxy.shadows[axis_number][1]);
+        }
+    }
+}
 
-    tmp = SATShadow{aabb.max_x, false, body};
-    auto maxpos = upper_bound(x_axis.begin(), x_axis.end(), tmp, cmp);
-    x_axis.insert(maxpos, move(tmp));
+void SATAxes::removeBody(Body* body) {
+    auto iter = body_proxies.find(body);
+    if (iter == body_proxies.end()) {
+        return;
+    }
+    auto proxy_index = iter->second;
+    auto& proxy = proxies[proxy_index];
+    if (proxy.pending) {
+        pending_proxies.erase(find(pending_proxies.begin(), pending_proxies.end(), proxy_index));
+        proxy.body = nullptr;
+        proxy.pending = false;
+        free_proxies.push_back(proxy_index);
+        body_proxies.erase(iter);
+        return;
+    }
 
-    tmp = SATShadow{aabb.min_y, true, body};
-    minpos = upper_bound(y_axis.begin(), y_axis.end(), tmp, cmp);
-    y_axis.insert(minpos, move(tmp));
+    for (auto other : proxy.overlaps) {
+        auto& other_overlaps = proxies[body_proxies[other]].overlaps;
+        other_overlaps.erase(remove(other_overlaps.begin(), other_overlaps.end(), body), other_overlaps.end());
+    }
+    proxy.overlaps.clear();
 
-    tmp = SATShadow{aabb.max_y, false, body};
-    maxpos = upper_bound(y_axis.begin(), y_axis.end(), tmp, cmp);
-    y_axis.insert(maxpos, move(tmp));
+    for (int axis_number = 0; axis_number < 2; ++axis_number) {
+        auto& axis = axes[axis_number];
+        auto start = proxy.shadows[axis_number][0];
+        axis.erase(axis.begin() + proxy.shadows[axis_number][1]);
+        axis.erase(axis.begin() + start);
+        for (auto i = start; i < axis.size(); ++i) {
+            proxies[axis[i].proxy].shadows[axis_number][!axis[i].start] = i;
+        }
+    }
+
+    proxy.body = nullptr;
+    free_proxies.push_back(proxy_index);
+    body_proxies.erase(iter);
 }
 
-void SATAxes::removeBody(Body* body) {
-    auto pred = [body](const SATShadow& sh){return sh.body == body;};
+void SATAxes::flush() {
+    // A few bodies are cheaper to sort in, but filling an empty world would be quadratic
+    if (pending_proxies.size() > 16) {
+        _rebuild();
+    }
+    else {
+        for (auto proxy_index : pending_proxies) {
+            _insertProxy(proxy_index);
+        }
+    }
+    pending_proxies.clear();
+}
 
-    x_axis.erase(remove_if(x_axis.begin(), x_axis.end(), pred), x_axis.end());
-    y_axis.erase(remove_if(y_axis.begin(), y_axis.end(), pred), y_axis.end());
+void SATAxes::_insertProxy(unsigned int proxy_index) {
+    auto& proxy = proxies[proxy_index];
+    proxy.pending = false;
+    for (int axis_number = 0; axis_number < 2; ++axis_number) {
+        auto& axis = axes[axis_number];
+        axis.push_back({shadowPosition(proxy.aabb, axis_number, true), true, proxy_index});
+        axis.push_back({shadowPosition(proxy.aabb, axis_number, false), false, proxy_index});
+        proxy.shadows[axis_number][0] = axis.size() - 2;
+        proxy.shadows[axis_number][1] = axis.size() - 1;
+        _moveShadow(axis_number, proxy.shadows[axis_number][0]);
+        _moveShadow(axis_number, proxy.shadows[axis_number][1]);
+    }
 }
 
-set<pair<Body*, Body*>> SATAxes::_collisionsOnAxis(const vector<SATShadow>& axis) {
-    auto stack = set<Body*>{};
-    auto result = set<pair<Body*, Body*>>{};
-    for (const auto& shadow : axis) {
+void SATAxes::_rebuild() {
+    // Sort the axes from scratch and find the overlaps with a single sweep along x
+    for (auto proxy_index : pending_proxies) {
+        auto& proxy = proxies[proxy_index];
+        proxy.pending = false;
+        for (int axis_number = 0; axis_number < 2; ++axis_number) {
+            axes[axis_number].push_back({shadowPosition(proxy.aabb, axis_number, true), true, proxy_index});
+            axes[axis_number].push_back({shadowPosition(proxy.aabb, axis_number, false), false, proxy_index});
+        }
+    }
+    for (int axis_number = 0; axis_number < 2; ++axis_number) {
+        auto& axis = axes[axis_number];
+        sort(axis.begin(), axis.end(), [](const SATShadow& a, const SATShadow& b) {
+            return shadowBefore(a, b) || (!shadowBefore(b, a) && a.proxy < b.proxy);
+        });
+        for (size_t i = 0; i < axis.size(); ++i) {
+            proxies[axis[i].proxy].shadows[axis_number][!axis[i].start] = i;
+        }
+    }
+
+    for (auto& proxy : proxies) {
+        proxy.overlaps.clear();
+    }
+    vector<unsigned int> active;
+    for (const auto& shadow : axes[0]) {
         if (shadow.start) {
-            for (const auto& other : stack) {
-                if (other < shadow.body) {
-                    result.insert({other, shadow.body});
-                }
-                else {
-                    result.insert({shadow.body, other});
+            auto& proxy = proxies[shadow.proxy];
+            for (auto other_index : active) {
+                auto& other = proxies[other_index];
+                if (proxy.aabb.overlaps(other.aabb)) {
+                    proxy.overlaps.push_back(other.body);
+                    other.overlaps.push_back(proxy.body);
                 }
             }
-            stack.insert(shadow.body);
+            active.push_back(shadow.proxy);
         }
         else {
-            stack.erase(shadow.body);
+            *find(active.begin(), active.end(), shadow.proxy) = active.back();
+            active.pop_back();
+        }
+    }
+}
+
+void SATAxes::_moveShadow(int axis_number, size_t index) {
+    // One step of insertion sort, in whichever direction the shadow needs to go
+    auto& axis = axes[axis_number];
+    auto shadow = axis[index];
+    while (index && shadowBefore(shadow, axis[index - 1])) {
+        _shadowsCrossed(shadow, axis[index - 1], true);
+        axis[index] = axis[index - 1];
+        proxies[axis[index].proxy].shadows[axis_number][!axis[index].start] = index;
+        --index;
+    }
+    while (index + 1 < axis.size() && shadowBefore(axis[index + 1], shadow)) {
+        _shadowsCrossed(shadow, axis[index + 1], false);
+        axis[index] = axis[index + 1];
+        proxies[axis[index].proxy].shadows[axis_number][!axis[index].start] = index;
+        ++index;
+    }
+    axis[index] = shadow;
+    proxies[shadow.proxy].shadows[axis_number][!shadow.start] = index;
+}
+
+void SATAxes::_shadowsCrossed(const SATShadow& moving, const SATShadow& other, bool leftwards) {
+    if (moving.proxy == other.proxy || moving.start == other.start) {
+        return;
+    }
+    auto& a = proxies[moving.proxy];
+    auto& b = proxies[other.proxy];
+    // A start moving left over an end (or an end moving right over a start) might make the pair overlap,
+    // the other way round always separates them on this axis
+    if (moving.start == leftwards) {
+        if (a.aabb.overlaps(b.aabb)) {
+            _addPair(a, b);
+        }
+    }
+    else {
+        _removePair(a, b);
+    }
+}
+
+void SATAxes::_addPair(SATProxy& a, SATProxy& b) {
+    if (find(a.overlaps.begin(), a.overlaps.end(), b.body) != a.overlaps.end()) {
+        return;
+    }
+    a.overlaps.push_back(b.body);
+    b.overlaps.push_back(a.body);
+}
+
+void SATAxes::_removePair(SATProxy& a, SATProxy& b) {
+    auto iter = find(a.overlaps.begin(), a.overlaps.end(), b.body);
+    if (iter == a.overlaps.end()) {
+        return;
+    }
+    *iter = a.overlaps.back();
+    a.overlaps.pop_back();
+    iter = find(b.overlaps.begin(), b.overlaps.end(), a.body);
+    *iter = b.overlaps.back();
+    b.overlaps.pop_back();
+}
+
+vector<pair<Body*, Body*>> SATAxes::possibleCollisions() const {
+    auto result = vector<pair<Body*, Body*>>{};
+    for (const auto& proxy : proxies) {
+        for (auto other : proxy.overlaps) {
+            if (proxy.body < other) {
+                result.push_back({proxy.body, other});
+            }
         }
     }
+    sort(result.begin(), result.end());
     return result;
 }
 
-set<pair<Body*, Body*>> SATAxes::possibleCollisions() {
-    auto xs = _collisionsOnAxis(x_axis);
-    auto ys = _collisionsOnAxis(y_axis);
-    auto result = set<pair<Body*, Body*>>{};
-    set_intersection(xs.begin(), xs.end(), ys.begin(), ys.end(), inserter(result, result.begin()));
+vector<pair<Body*, Body*>> SATAxes::possibleCollisions(const vector<Body*>& bodies) const {
+    auto result = vector<pair<Body*, Body*>>{};
+    for (auto body : bodies) {
+        auto iter = body_proxies.find(body);
+        if (iter == body_proxies.end()) {
+            continue;
+        }
+        for (auto other : proxies[iter->second].overlaps) {
+            result.push_back(body < other ? make_pair(body, other) : make_pair(other, body));
+        }
+    }
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
     return result;
 }
@@ -21,27 +21,51 @@
 #define SHYPHE_SATAXES_HPP
 
 #include <vector>
-#include <set>
+#include <unordered_map>
 #include <utility>
+#include "aabb.hpp"
 #include "body.hpp"
+#include "broadphase.hpp"
 
 namespace shyphe {
     struct SATShadow {
         double position;
         bool start;
+        unsigned int proxy;
+    };
+
+    struct SATProxy {
         Body* body;
+        AABB aabb;
+        // Index of the start and end shadow on each axis
+        std::size_t shadows[2][2];
+        std::vector<Body*> overlaps;
+        // Not on the axes yet, see SATAxes::flush
+        bool pending;
     };
 
-    class SATAxes{
+    // Sweep and prune over the x and y axes. The axes are kept sorted between calls, so moving a body only
+    // costs the number of shadows it passes, and the overlapping pairs are updated as the shadows cross.
+    class SATAxes : public Broadphase {
     public:
-        void addBody(Body* body, double time);
-        void removeBody(Body* body);
-        void reset(int reserve_hint=0);
-        std::set<std::pair<Body*, Body*>> possibleCollisions();
+        virtual void updateBody(Body* body, double time) override;
+        virtual void removeBody(Body* body) override;
+        virtual void flush() override;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions() const override;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions(const std::vector<Body*>& bodies) const override;
     private:
-        std::vector<SATShadow> x_axis, y_axis;
+        std::vector<SATShadow> axes[2];
+        std::vector<SATProxy> proxies;
+        std::vector<unsigned int> free_proxies;
+        std::vector<unsigned int> pending_proxies;
+        std::unordered_map<Body*, unsigned int> body_proxies;
 
-        std::set<std::pair<Body*, Body*>> _collisionsOnAxis(const std::vector<SATShadow>& axis);
+        void _insertProxy(unsigned int proxy_index);
+        void _rebuild();
+        void _moveShadow(int axis_number, std::size_t index);
+        void _shadowsCrossed(const SATShadow& moving, const SATShadow& other, bool leftwards);
+        void _addPair(SATProxy& a, SATProxy& b);
+        void _removePair(SATProxy& a, SATProxy& b);
     };
 }
 
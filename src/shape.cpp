@@ -18,14 +18,29 @@
  */
 
 #include "shape.hpp"
+#include "body.hpp"
 
 using namespace std;
 using namespace shyphe;
 
-Shape::Shape(double mass_/*=0*/, const Vec& position_/*={}*/,
+Shape::Shape(unsigned int kind_, double mass_/*=0*/, const Vec& position_/*={}*/,
              double radar_cross_section/*=0*/, double radar_emissions/*=0*/, double thermal_emissions/*=0*/) : mass(mass_),
                                                                                                                position(position_),
                                                                                                                signature{radar_emissions,
                                                                                                                          thermal_emissions,
-                                                                                                                         radar_cross_section} {
+                                                                                                                         radar_cross_section},
+                                                                                                               _kind(kind_) {
+}
+
+Shape::Shape(const Shape& other) : enable_shared_from_this(other),
+                                   mass(other.mass),
+                                   position(other.position),
+                                   signature(other.signature),
+                                   _kind(other._kind) {
+}
+
+void Shape::changed() {
+    for (auto body : _owners) {
+        body->_updateShapeCache();
+    }
 }
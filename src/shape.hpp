@@ -23,8 +23,8 @@
 #include "aabb.hpp"
 #include "collisions.hpp"
 #include "vec.hpp"
-#include <typeindex>
 #include <memory>
+#include <vector>
 
 namespace shyphe {
     class Body;
@@ -59,20 +59,46 @@ namespace shyphe {
         }
     };
 
+    // Shape kinds index the narrowphase dispatch table. New kinds can be added with registerShapeKind.
+    const unsigned int MAX_SHAPE_KINDS = 16;
+    enum BuiltinShapeKind : unsigned int {
+        MASS_SHAPE_KIND,
+        CIRCLE_KIND,
+        POLYGON_KIND,
+        BUILTIN_SHAPE_KINDS
+    };
+
     class Shape : public std::enable_shared_from_this<Shape> {
     public:
         double mass = 0;
         Vec position;
         Signature signature;
 
-        Shape(double mass_=0, const Vec& position_={}, double radar_cross_section=0, double radar_emissions=0, double thermal_emissions=0);
+        Shape(unsigned int kind_, double mass_=0, const Vec& position_={},
+              double radar_cross_section=0, double radar_emissions=0, double thermal_emissions=0);
+        // Copies are not added to any bodies
+        Shape(const Shape& other);
+        Shape& operator=(const Shape& other) = delete;
         virtual ~Shape() = default;
-        virtual AABB aabb(double angle) const = 0;
+        virtual AABB aabb(const Rot& rot) const = 0;
         virtual Shape* clone() const = 0;
         virtual bool canCollide() const = 0;
-        virtual std::type_index shape_type() const = 0;
         virtual double boundingRadius() const = 0;
         virtual double momentOfInertia() const = 0;
+
+        // Must be called after modifying a shape which has already been added to a body. The bodies it belongs to
+        // refresh their cached mass properties and outlines straight away, so do not call it during a frame.
+        void changed();
+
+        inline unsigned int kind() const {
+            return _kind;
+        }
+    private:
+        unsigned int _kind;
+        // Bodies this shape has been added to, kept up to date by Body
+        std::vector<Body*> _owners;
+
+        friend class Body;
     };
 }
 
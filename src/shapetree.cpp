@@ -0,0 +1,86 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "shapetree.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace shyphe;
+
+void ShapeTree::build(vector<Leaf> leaves) {
+    _nodes.clear();
+    _nodes.reserve(leaves.size() ? 2 * leaves.size() - 1 : 0);
+    if (leaves.size()) {
+        _build(leaves, 0, leaves.size());
+    }
+}
+
+void ShapeTree::_build(vector<Leaf>& leaves, size_t begin, size_t end) {
+    auto node = _nodes.size();
+    if (end - begin == 1) {
+        const auto& leaf = leaves[begin];
+        _nodes.push_back({leaf.centre, leaf.radius, -1, leaf.index, 1});
+        return;
+    }
+    _nodes.push_back({{}, 0, -1, 0, static_cast<unsigned int>(end - begin)});
+
+    // Split at the median along the longer side of the centres' box
+    auto min_x = leaves[begin].centre.x, max_x = min_x, min_y = leaves[begin].centre.y, max_y = min_y;
+    for (auto i = begin + 1; i < end; ++i) {
+        min_x = min(min_x, leaves[i].centre.x);
+        max_x = max(max_x, leaves[i].centre.x);
+        min_y = min(min_y, leaves[i].centre.y);
+        max_y = max(max_y, leaves[i].centre.y);
+    }
+    bool x_axis = max_x - min_x >= max_y - min_y;
+    auto mid = begin + (end - begin) / 2;
+    nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end,
+                [x_axis](const Leaf& a, const Leaf& b) {
+                    return x_axis ? a.centre.x < b.centre.x : a.centre.y < b.centre.y;
+                });
+
+    _build(leaves, begin, mid);
+    int second = _nodes.size();
+    _build(leaves, mid, end);
+
+    // Smallest circle around the two children's circles
+    const auto& a = _nodes[node + 1];
+    const auto& b = _nodes[second];
+    auto offset = b.centre - a.centre;
+    auto distance = offset.abs();
+    Vec centre;
+    double radius;
+    if (distance + b.radius <= a.radius) {
+        centre = a.centre;
+        radius = a.radius;
+    }
+    else if (distance + a.radius <= b.radius) {
+        centre = b.centre;
+        radius = b.radius;
+    }
+    else {
+        radius = (distance + a.radius + b.radius) / 2;
+        centre = a.centre + offset * ((radius - a.radius) / distance);
+    }
+    _nodes[node].centre = centre;
+    _nodes[node].radius = radius;
+    _nodes[node].second = second;
+}
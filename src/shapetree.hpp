@@ -0,0 +1,68 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_SHAPETREE_HPP
+#define SHYPHE_SHAPETREE_HPP
+
+#include <vector>
+#include "vec.hpp"
+
+namespace shyphe {
+    // Bounding circle hierarchy over the shapes of a body, in the body's local space. Circles do not change as the
+    // body turns, so the tree only needs rebuilding when the shapes do.
+    class ShapeTree {
+    public:
+        struct Leaf {
+            Vec centre;
+            double radius;
+            unsigned int index;
+        };
+
+        // Stored depth first, so a branch's first child follows it
+        struct Node {
+            Vec centre;
+            double radius;
+            // Child after the first, or -1 for a leaf
+            int second;
+            // Leaf::index for a leaf
+            unsigned int index;
+            unsigned int leaves;
+
+            inline bool leaf() const {
+                return second == -1;
+            }
+        };
+
+        void build(std::vector<Leaf> leaves);
+
+        inline const std::vector<Node>& nodes() const {
+            return _nodes;
+        }
+
+        inline bool empty() const {
+            return _nodes.empty();
+        }
+    private:
+        std::vector<Node> _nodes;
+
+        void _build(std::vector<Leaf>& leaves, std::size_t begin, std::size_t end);
+    };
+}
+
+#endif // SHYPHE_SHAPETREE_HPP
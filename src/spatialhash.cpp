@@ -0,0 +1,241 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "spatialhash.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace shyphe;
+
+const int MAX_CELLS_PER_BODY = 64;
+const int MAX_CELL_COORDINATE = 1 << 30;
+
+inline uint64_t cellKey(int x, int y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+inline void addPair(vector<pair<Body*, Body*>>& result, Body* a, Body* b) {
+    result.push_back(a < b ? make_pair(a, b) : make_pair(b, a));
+}
+
+SpatialHash::SpatialHash(double cell_size_/*=0*/) : cell_size(cell_size_ > 0 ? cell_size_ : 1), automatic(cell_size_ <= 0) {
+}
+
+// Cell coordinate of position, clamped so that the coordinates and their differences fit in an int. NaN gives
+// nan_cell, so a box with NaN bounds covers every cell and is treated as large.
+inline int cellCoordinate(double position, double cell_size, int nan_cell) {
+    auto cell = floor(position / cell_size);
+    if (cell != cell) {
+        return nan_cell;
+    }
+    return max<double>(-MAX_CELL_COORDINATE, min<double>(cell, MAX_CELL_COORDINATE));
+}
+
+void SpatialHash::_setRange(SpatialHashProxy& proxy) const {
+    proxy.min_x = cellCoordinate(proxy.aabb.min_x, cell_size, -MAX_CELL_COORDINATE);
+    proxy.max_x = cellCoordinate(proxy.aabb.max_x, cell_size, MAX_CELL_COORDINATE);
+    proxy.min_y = cellCoordinate(proxy.aabb.min_y, cell_size, -MAX_CELL_COORDINATE);
+    proxy.max_y = cellCoordinate(proxy.aabb.max_y, cell_size, MAX_CELL_COORDINATE);
+    auto width = static_cast<int64_t>(proxy.max_x) - proxy.min_x + 1;
+    auto height = static_cast<int64_t>(proxy.max_y) - proxy.min_y + 1;
+    proxy.large = width * height > MAX_CELLS_PER_BODY;
+}
+
+void SpatialHash::_insert(unsigned int proxy_index) {
+    const auto& proxy = proxies[proxy_index];
+    if (proxy.large) {
+        large_proxies.push_back(proxy_index);
+        return;
+    }
+    for (auto x = proxy.min_x; x <= proxy.max_x; ++x) {
+        for (auto y = proxy.min_y; y <= proxy.max_y; ++y) {
+            cells[cellKey(x, y)].push_back(proxy_index);
+        }
+    }
+}
+
+void SpatialHash::_remove(unsigned int proxy_index) {
+    const auto& proxy = proxies[proxy_index];
+    if (proxy.large) {
+        large_proxies.erase(find(large_proxies.begin(), large_proxies.end(), proxy_index));
+        return;
+    }
+    for (auto x = proxy.min_x; x <= proxy.max_x; ++x) {
+        for (auto y = proxy.min_y; y <= proxy.max_y; ++y) {
+            auto iter = cells.find(cellKey(x, y));
+            auto& members = iter->second;
+            *find(members.begin(), members.end(), proxy_index) = members.back();
+            members.pop_back();
+            if (members.empty()) {
+                cells.erase(iter);
+            }
+        }
+    }
+}
+
+void SpatialHash::_chooseCellSize() {
+    resize_at = body_proxies.size() * 2;
+    vector<double> radii;
+    radii.reserve(body_proxies.size());
+    for (const auto& item : body_proxies) {
+        radii.push_back(proxies[item.second].radius);
+    }
+    auto median = radii.begin() + radii.size() / 2;
+    nth_element(radii.begin(), median, radii.end());
+    // About the diameter of a typical body, so most bodies cover a handful of cells
+    auto new_cell_size = *median * 2;
+    if (new_cell_size <= 0 || new_cell_size == cell_size) {
+        return;
+    }
+
+    for (const auto& item : body_proxies) {
+        _remove(item.second);
+    }
+    cell_size = new_cell_size;
+    for (const auto& item : body_proxies) {
+        _setRange(proxies[item.second]);
+        _insert(item.second);
+    }
+}
+
+void SpatialHash::updateBody(Body* body, double time) {
+    auto aabb = body->position() + body->aabb(time);
+
+    auto iter = body_proxies.find(body);
+    if (iter == body_proxies.end()) {
+        unsigned int proxy_index;
+        auto proxy = SpatialHashProxy{body, aabb, automatic ? body->boundingRadius() : 0, 0, 0, 0, 0, false};
+        _setRange(proxy);
+        if (free_proxies.size()) {
+            proxy_index = free_proxies.back();
+            free_proxies.pop_back();
+            proxies[proxy_index] = proxy;
+        }
+        else {
+            proxy_index = proxies.size();
+            proxies.push_back(proxy);
+        }
+        body_proxies[body] = proxy_index;
+        _insert(proxy_index);
+
+        if (automatic && body_proxies.size() >= resize_at) {
+            _chooseCellSize();
+        }
+        return;
+    }
+
+    auto proxy_index = iter->second;
+    auto moved = proxies[proxy_index];
+    moved.aabb = aabb;
+    if (automatic) {
+        moved.radius = body->boundingRadius();
+    }
+    _setRange(moved);
+    const auto& proxy = proxies[proxy_index];
+    if (tie(moved.min_x, moved.max_x, moved.min_y, moved.max_y, moved.large)
+        != tie(proxy.min_x, proxy.max_x, proxy.min_y, proxy.max_y, proxy.large)) {
+        _remove(proxy_index);
+        proxies[proxy_index] = moved;
+        _insert(proxy_index);
+    }
+    else {
+        proxies[proxy_index] = moved;
+    }
+}
+
+void SpatialHash::removeBody(Body* body) {
+    auto iter = body_proxies.find(body);
+    if (iter == body_proxies.end()) {
+        return;
+    }
+    _remove(iter->second);
+    proxies[iter->second].body = nullptr;
+    free_proxies.push_back(iter->second);
+    body_proxies.erase(iter);
+}
+
+vector<pair<Body*, Body*>> SpatialHash::possibleCollisions() const {
+    auto result = vector<pair<Body*, Body*>>{};
+    for (const auto& cell : cells) {
+        int x = static_cast<int32_t>(cell.first >> 32), y = static_cast<int32_t>(cell.first & 0xffffffff);
+        const auto& members = cell.second;
+        for (auto i = members.begin(); i != members.end(); ++i) {
+            const auto& a = proxies[*i];
+            for (auto j = i + 1; j != members.end(); ++j) {
+                const auto& b = proxies[*j];
+                // Pairs sharing several cells are only reported from the first cell they share
+                if (max(a.min_x, b.min_x) != x || max(a.min_y, b.min_y) != y || !a.aabb.overlaps(b.aabb)) {
+                    continue;
+                }
+                addPair(result, a.body, b.body);
+            }
+        }
+    }
+    for (auto large : large_proxies) {
+        const auto& a = proxies[large];
+        for (const auto& item : body_proxies) {
+            const auto& b = proxies[item.second];
+            if (item.second == large || (b.large && item.second < large) || !a.aabb.overlaps(b.aabb)) {
+                continue;
+            }
+            addPair(result, a.body, b.body);
+        }
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+vector<pair<Body*, Body*>> SpatialHash::possibleCollisions(const vector<Body*>& bodies) const {
+    auto result = vector<pair<Body*, Body*>>{};
+    for (auto body : bodies) {
+        auto iter = body_proxies.find(body);
+        if (iter == body_proxies.end()) {
+            continue;
+        }
+        auto proxy_index = iter->second;
+        const auto& proxy = proxies[proxy_index];
+        if (proxy.large) {
+            for (const auto& item : body_proxies) {
+                if (item.second != proxy_index && proxy.aabb.overlaps(proxies[item.second].aabb)) {
+                    addPair(result, body, item.first);
+                }
+            }
+            continue;
+        }
+        for (auto x = proxy.min_x; x <= proxy.max_x; ++x) {
+            for (auto y = proxy.min_y; y <= proxy.max_y; ++y) {
+                for (auto other : cells.at(cellKey(x, y))) {
+                    if (other != proxy_index && proxy.aabb.overlaps(proxies[other].aabb)) {
+                        addPair(result, body, proxies[other].body);
+                    }
+                }
+            }
+        }
+        for (auto other : large_proxies) {
+            if (proxy.aabb.overlaps(proxies[other].aabb)) {
+                addPair(result, body, proxies[other].body);
+            }
+        }
+    }
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+}
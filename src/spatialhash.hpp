@@ -0,0 +1,73 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_SPATIALHASH_HPP
+#define SHYPHE_SPATIALHASH_HPP
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include "aabb.hpp"
+#include "body.hpp"
+#include "broadphase.hpp"
+
+namespace shyphe {
+    struct SpatialHashProxy {
+        Body* body;
+        AABB aabb;
+        double radius;
+        // Range of cells covered, inclusive
+        int min_x, max_x, min_y, max_y;
+        bool large;
+    };
+
+    // Uniform grid, hashed so only occupied cells are stored. Each body is binned into all the cells its swept
+    // AABB covers. Bodies covering too many cells are kept in a separate list and checked against everything.
+    // With a cell size of 0 the size is chosen from the median bounding radius, and rechosen as the number of
+    // bodies doubles.
+    class SpatialHash : public Broadphase {
+    public:
+        SpatialHash(double cell_size_=0);
+        virtual void updateBody(Body* body, double time) override;
+        virtual void removeBody(Body* body) override;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions() const override;
+        virtual std::vector<std::pair<Body*, Body*>> possibleCollisions(const std::vector<Body*>& bodies) const override;
+
+        inline double cellSize() const {
+            return cell_size;
+        }
+    private:
+        double cell_size;
+        bool automatic;
+        std::size_t resize_at = 1;
+        std::vector<SpatialHashProxy> proxies;
+        std::vector<unsigned int> free_proxies;
+        std::unordered_map<Body*, unsigned int> body_proxies;
+        std::unordered_map<std::uint64_t, std::vector<unsigned int>> cells;
+        std::vector<unsigned int> large_proxies;
+
+        void _setRange(SpatialHashProxy& proxy) const;
+        void _insert(unsigned int proxy_index);
+        void _remove(unsigned int proxy_index);
+        void _chooseCellSize();
+    };
+}
+
+#endif // SHYPHE_SPATIALHASH_HPP
@@ -0,0 +1,112 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace shyphe;
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    for (unsigned int i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::_work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const function<void(size_t)>& func) {
+    if (workers.empty() || n < 2) {
+        for (size_t i = 0; i < n; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+        job = &func;
+        job_size = n;
+        chunk = max<size_t>(1, n / (size() * 8));
+        next = 0;
+        error = nullptr;
+        active = workers.size();
+        ++generation;
+    }
+    start_cv.notify_all();
+    _run();
+
+    unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]{return !active;});
+    job = nullptr;
+    if (error) {
+        rethrow_exception(error);
+    }
+}
+
+void ThreadPool::_run() {
+    while (true) {
+        auto start = next.fetch_add(chunk);
+        if (start >= job_size) {
+            return;
+        }
+        auto end = min(start + chunk, job_size);
+        try {
+            for (auto i = start; i < end; ++i) {
+                (*job)(i);
+            }
+        }
+        catch (...) {
+            lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = current_exception();
+            }
+            next = job_size;
+        }
+    }
+}
+
+void ThreadPool::_work() {
+    unsigned int seen = 0;
+    while (true) {
+        {
+            unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [this, seen]{return stopping || generation != seen;});
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        _run();
+        lock_guard<std::mutex> lock(mutex);
+        if (!--active) {
+            done_cv.notify_all();
+        }
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * shyphe - Stiff HIgh velocity PHysics Engine
+ * Copyright (C) 2017 Matthew Joyce matsjoyce@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHYPHE_THREADPOOL_HPP
+#define SHYPHE_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shyphe {
+    // Fixed set of worker threads for data-parallel loops. The calling thread joins in, so a pool of n threads
+    // starts n - 1 workers. Indices are handed out in small chunks from a shared counter, so threads that finish
+    // early take work from the rest of the range.
+    class ThreadPool {
+    public:
+        ThreadPool(unsigned int threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Calls func(i) for every i in [0, n) and waits for them all. The first exception thrown is rethrown here.
+        void parallelFor(std::size_t n, const std::function<void(std::size_t)>& func);
+
+        inline unsigned int size() const {
+            return workers.size() + 1;
+        }
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable start_cv, done_cv;
+        const std::function<void(std::size_t)>* job = nullptr;
+        std::size_t job_size = 0, chunk = 1;
+        std::atomic<std::size_t> next{0};
+        unsigned int generation = 0, active = 0;
+        bool stopping = false;
+        std::exception_ptr error;
+
+        void _work();
+        void _run();
+    };
+}
+
+#endif // SHYPHE_THREADPOOL_HPP
@@ -25,6 +25,34 @@
 #include <tuple>
 
 namespace shyphe {
+    // Rotation by an angle, with the cosine and sine worked out once. Clockwise, like Vec::rotate.
+    class Rot {
+    public:
+        constexpr Rot(double c_, double s_) : c(c_), s(s_) {
+        }
+
+        constexpr Rot() : c(1), s(0) {
+        }
+
+        explicit Rot(double angle) : c(std::cos(angle)), s(std::sin(angle)) {
+        }
+
+        // Rotation by this then other
+        inline Rot operator*(const Rot& other) const {
+            return {c * other.c - s * other.s, s * other.c + c * other.s};
+        }
+
+        inline Rot inverse() const {
+            return {c, -s};
+        }
+
+        inline double angle() const {
+            return std::atan2(s, c);
+        }
+
+        double c, s;
+    };
+
     class Vec {
     public:
         constexpr Vec(double x_, double y_) : x(x_), y(y_) {
@@ -145,10 +173,13 @@ namespace shyphe {
             return {std::sin(bearing), std::cos(bearing)};
         }
 
-        inline Vec rotate(double bearing) const {
+        inline Vec rotate(const Rot& rot) const {
             // Clockwise
-            double c = std::cos(bearing), s = std::sin(bearing);
-            return {c * x + s * y, -s * x + c * y};
+            return {rot.c * x + rot.s * y, -rot.s * x + rot.c * y};
+        }
+
+        inline Vec rotate(double bearing) const {
+            return rotate(Rot(bearing));
         }
 
         double x, y;
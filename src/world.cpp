@@ -18,93 +18,243 @@
  */
 
 #include "world.hpp"
+#include "sataxes.hpp"
+#include "aabbtree.hpp"
+#include "spatialhash.hpp"
 
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <set>
+#include <tuple>
 
 using namespace std;
 using namespace shyphe;
 
-pair<Body*, Body*> make_body_pair(Body* a, Body* b) {
-    return (a < b) ? make_pair(a, b) : make_pair(b, a);
+World::World(double frame_time_/*=1*/,
+             BroadphaseType broadphase_type/*=BroadphaseType::sat_axes*/,
+             double cell_size/*=0*/) : time_until(frame_time_), frame_time(frame_time_) {
+    switch (broadphase_type) {
+        case BroadphaseType::sat_axes:
+            broadphase = make_unique<SATAxes>();
+            break;
+        case BroadphaseType::aabb_tree:
+            broadphase = make_unique<AABBTree>();
+            break;
+        case BroadphaseType::spatial_hash:
+            broadphase = make_unique<SpatialHash>(cell_size);
+            break;
+    }
 }
 
-World::World(double frame_time_/*=1*/) : time_until(frame_time_), frame_time(frame_time_) {
+World::~World() {
+    for (const auto& body : _bodies) {
+        body->_world_slot = -1;
+    }
 }
 
 void World::beginFrame() {
+    toi_stats = {};
     sigobjs.clear();
     sigobjs.reserve(_bodies.size());
     for (const auto& body: _bodies) {
         sigobjs.push_back({body->position(), body->signature(), body.get()});
     }
-    for (const auto body : _bodies) {
-        _updateBodySensorView(body.get());
+    vector<Vec> positions;
+    positions.reserve(sigobjs.size());
+    for (const auto& sig : sigobjs) {
+        positions.push_back(sig.position);
+    }
+    sigobj_tree.build(positions);
+    if (thread_pool) {
+        // Each body only writes its own sensor view
+        thread_pool->parallelFor(_bodies.size(), [this](size_t i) {
+            _updateBodySensorView(_bodies[i].get());
+        });
+    }
+    else {
+        for (const auto body : _bodies) {
+            _updateBodySensorView(body.get());
+        }
     }
     _updateCollisionTimes(true);
 }
 
+void World::writePositions(double* out) const {
+    for (const auto& body : _bodies) {
+        *out++ = body->position().x;
+        *out++ = body->position().y;
+    }
+}
+
+void World::writeVelocities(double* out) const {
+    for (const auto& body : _bodies) {
+        *out++ = body->velocity().x;
+        *out++ = body->velocity().y;
+    }
+}
+
+void World::writeAngles(double* out) const {
+    for (const auto& body : _bodies) {
+        *out++ = body->angle();
+    }
+}
+
+void World::writeAABBs(double* out, double time) const {
+    for (const auto& body : _bodies) {
+        auto aabb = body->position() + body->aabb(time);
+        *out++ = aabb.min_x;
+        *out++ = aabb.max_x;
+        *out++ = aabb.min_y;
+        *out++ = aabb.max_y;
+    }
+}
+
 void World::endFrame() {
-    for (auto body : _bodies) {
-        body->update(time_until - body_times[body.get()]);
-        body_times[body.get()] = time_until;
+    auto advance = [this](BodySlot& slot) {
+        if (slot.body) {
+            slot.body->update(time_until - slot.time);
+            slot.time = time_until;
+        }
+    };
+    if (thread_pool) {
+        // Each body only touches its own state and slot
+        thread_pool->parallelFor(body_slots.size(), [this, &advance](size_t i) {
+            advance(body_slots[i]);
+        });
+    }
+    else {
+        for (auto& slot : body_slots) {
+            advance(slot);
+        }
     }
     current_time = time_until;
     time_until = current_time + frame_time;
 }
 
+void World::setThreads(unsigned int threads) {
+    if (threads > 1) {
+        thread_pool = make_unique<ThreadPool>(threads);
+    }
+    else {
+        thread_pool.reset();
+    }
+}
+
 void World::addBody(shared_ptr<Body> body) {
+    if (body->_world_slot != -1) {
+        throw runtime_error("Body is already in a world");
+    }
+    if (free_slots.empty()) {
+        body->_world_slot = body_slots.size();
+        body_slots.emplace_back();
+    }
+    else {
+        body->_world_slot = free_slots.back();
+        free_slots.pop_back();
+    }
+    _slot(body.get()) = {body.get(), current_time, next_body_id++, false, _bodies.size()};
     _bodies.push_back(body);
-    body_times[body.get()] = current_time;
-    changed_bodies.insert(body.get());
+    _markChanged(body.get());
 }
 
 void World::removeBody(shared_ptr<Body> body) {
-    body_times.erase(body.get());
-    removed_bodies.insert(body.get());
-    changed_bodies.erase(body.get());
-    _bodies.erase(remove(_bodies.begin(), _bodies.end(), body), _bodies.end());
-    auto pred = [this, &body](const tuple<CollisionTimeResult, Shape*, Body*, Shape*, Body*>& col)
-                {return body.get() == get<2>(col) || body.get() == get<4>(col);};
-    collision_times.erase(remove_if(collision_times.begin(), collision_times.end(), pred), collision_times.end());
+    auto slot = body->_world_slot;
+    if (slot < 0 || slot >= static_cast<int>(body_slots.size()) || body_slots[slot].body != body.get()) {
+        return;
+    }
+    ignore_current_collision.removeId(body_slots[slot].id);
+    if (body_slots[slot].changed) {
+        changed_bodies.erase(find(changed_bodies.begin(), changed_bodies.end(), body.get()));
+    }
+    long index = body_slots[slot].index;
+    body_slots[slot] = {nullptr, 0, 0, false, 0};
+    free_slots.push_back(slot);
+    body->_world_slot = -1;
+    broadphase->removeBody(body.get());
+    _bodies.erase(_bodies.begin() + index);
+    for (auto i = static_cast<size_t>(index); i < _bodies.size(); ++i) {
+        _slot(_bodies[i].get()).index = i;
+    }
+    // Keep the indexes of the events already recorded by step pointing at the same bodies
+    if (step_events) {
+        for (auto& event : *step_events) {
+            for (auto id : {&event.a, &event.b}) {
+                if (*id == index) {
+                    *id = -1;
+                }
+                else if (*id > index) {
+                    --*id;
+                }
+            }
+        }
+    }
+    collision_queue.removeBody(body.get());
+}
+
+void World::_markChanged(Body* body) {
+    auto& slot = _slot(body);
+    if (!slot.changed) {
+        slot.changed = true;
+        changed_bodies.push_back(body);
+    }
 }
 
 void World::_updateCollisionTimes(bool initial) {
+    vector<pair<Body*, Body*>> possibleCollisions;
     if (initial) {
-        sat_axes.reset(_bodies.size());
         for (auto body : _bodies) {
-            sat_axes.addBody(body.get(), frame_time);
+            broadphase->updateBody(body.get(), frame_time);
         }
+        broadphase->flush();
+        possibleCollisions = broadphase->possibleCollisions();
     }
     else {
         for (auto body : changed_bodies) {
-            sat_axes.removeBody(body);
-            sat_axes.addBody(body, time_until - body_times[body]);
-        }
-        for (auto body : removed_bodies) {
-            sat_axes.removeBody(body);
+            broadphase->updateBody(body, time_until - _slot(body).time);
         }
+        broadphase->flush();
+        possibleCollisions = broadphase->possibleCollisions(changed_bodies);
     }
-    auto possibleCollisions = sat_axes.possibleCollisions();
-    for (const auto& poscol : possibleCollisions) {
-        if (!initial && !changed_bodies.count(poscol.first) && !changed_bodies.count(poscol.second)) {
-            continue;
+    _orderPairs(possibleCollisions);
+
+    vector<tuple<CollisionTimeResult, Shape*, Shape*>> initial_results;
+    if (initial && thread_pool) {
+        // Body::collide only reads the bodies, so the initial pairs can be done in parallel. The results are
+        // still queued in pair order below, so the collisions come out exactly as with one thread.
+        vector<char> ignore(possibleCollisions.size());
+        for (size_t i = 0; i < possibleCollisions.size(); ++i) {
+            ignore[i] = ignore_current_collision.get(_slot(possibleCollisions[i].first).id, _slot(possibleCollisions[i].second).id);
         }
+        initial_results.resize(possibleCollisions.size());
+        thread_pool->parallelFor(possibleCollisions.size(), [this, &possibleCollisions, &ignore, &initial_results](size_t i) {
+            initial_results[i] = possibleCollisions[i].first->collide(possibleCollisions[i].second, frame_time, ignore[i], toi_solver);
+        });
+    }
 
+    for (size_t i = 0; i < possibleCollisions.size(); ++i) {
+        const auto& poscol = possibleCollisions[i];
         double time_window = frame_time, start_time = current_time;
         BodyState a_state = poscol.first->state(), b_state = poscol.second->state();
+        const auto& a_slot = _slot(poscol.first);
+        const auto& b_slot = _slot(poscol.second);
         if (!initial) {
-            start_time = max(body_times[poscol.first], body_times[poscol.second]);
-            poscol.first->update(start_time - body_times[poscol.first]);
-            poscol.second->update(start_time - body_times[poscol.second]);
+            start_time = max(a_slot.time, b_slot.time);
+            poscol.first->update(start_time - a_slot.time);
+            poscol.second->update(start_time - b_slot.time);
             time_window = time_until - start_time;
         }
-        auto p = make_body_pair(poscol.second, poscol.first);
         CollisionTimeResult colresult;
         Shape* a;
         Shape* b;
-        tie(colresult, a, b) = poscol.first->collide(poscol.second, time_window, ignore_current_collision[p]);
+        if (initial_results.size()) {
+            tie(colresult, a, b) = initial_results[i];
+        }
+        else {
+            auto ignore = ignore_current_collision.get(a_slot.id, b_slot.id);
+            tie(colresult, a, b) = poscol.first->collide(poscol.second, time_window, ignore, toi_solver);
+        }
+        toi_stats.add(colresult.iterations, colresult.culled);
 
         if (!initial) {
             poscol.first->reset(a_state);
@@ -115,42 +265,56 @@ void World::_updateCollisionTimes(bool initial) {
             continue;
         }
         colresult.time += start_time;
-        auto collision = make_tuple(colresult, a, poscol.first, b, poscol.second);
-        // Put in reverse order to allow pop from back
-        auto pos = upper_bound(collision_times.begin(), collision_times.end(), collision,
-                               [](const tuple<CollisionTimeResult, Shape*, Body*, Shape*, Body*>& a,
-                                  const tuple<CollisionTimeResult, Shape*, Body*, Shape*, Body*>& b)
-                               {return get<0>(a).time > get<0>(b).time;});
-        collision_times.insert(pos, collision);
+        collision_queue.push({colresult, a, poscol.first, b, poscol.second});
     }
     if (!initial) {
+        for (auto body : changed_bodies) {
+            _slot(body).changed = false;
+        }
         changed_bodies.clear();
-        removed_bodies.clear();
+    }
+}
+
+void World::_orderPairs(vector<pair<Body*, Body*>>& pairs) {
+    // The broadphases order pairs by address, which changes from run to run. Use the order the bodies were added
+    // instead, so a replay gives the same collisions down to the last bit.
+    vector<tuple<unsigned long, unsigned long, Body*, Body*>> keyed;
+    keyed.reserve(pairs.size());
+    for (const auto& p : pairs) {
+        auto first = _slot(p.first).id, second = _slot(p.second).id;
+        if (first < second) {
+            keyed.emplace_back(first, second, p.first, p.second);
+        }
+        else {
+            keyed.emplace_back(second, first, p.second, p.first);
+        }
+    }
+    sort(keyed.begin(), keyed.end());
+    for (size_t i = 0; i < keyed.size(); ++i) {
+        pairs[i] = {get<2>(keyed[i]), get<3>(keyed[i])};
     }
 }
 
 bool World::hasNextCollision() {
-    return collision_times.size();
+    return !collision_queue.empty();
 }
 
 UnresolvedCollision World::nextCollision() {
-    if (!collision_times.size()) {
+    if (collision_queue.empty()) {
         throw runtime_error("No collisions! Check has_next_collision first!");
     }
 
-    CollisionTimeResult colresult;
-    Shape* a;
-    Body* a_body;
-    Shape* b;
-    Body* b_body;
-
-    tie(colresult, a, a_body, b, b_body) = collision_times.back();
-    collision_times.pop_back();
-    changed_bodies.insert(a_body);
-    changed_bodies.insert(b_body);
-    a_body->update(colresult.time - body_times[a_body]);
-    b_body->update(colresult.time - body_times[b_body]);
-    body_times[a_body] = body_times[b_body] = colresult.time;
+    auto collision = collision_queue.pop();
+    auto& colresult = collision.result;
+    auto a_body = collision.a;
+    auto b_body = collision.b;
+    _markChanged(a_body);
+    _markChanged(b_body);
+    auto& a_slot = _slot(a_body);
+    auto& b_slot = _slot(b_body);
+    a_body->update(colresult.time - a_slot.time);
+    b_body->update(colresult.time - b_slot.time);
+    a_slot.time = b_slot.time = colresult.time;
     return {a_body->shared_from_this(), b_body->shared_from_this(), colresult.time, colresult.touch_point, colresult.normal};
 }
 
@@ -172,11 +336,48 @@ std::pair<ResolvedCollision, ResolvedCollision> World::calculateCollision(const
                               }};
 }
 
+std::vector<CollisionEvent> World::step(const CollisionParameters& params, const CollisionCallback& callback/*={}*/) {
+    vector<CollisionEvent> events;
+    auto index = [this](const shared_ptr<Body>& body) {
+        return body->_world_slot == -1 ? -1l : static_cast<long>(_slot(body.get()).index);
+    };
+    step_events = &events;
+    try {
+        beginFrame();
+        while (hasNextCollision()) {
+            auto collision = nextCollision();
+            auto resolved = calculateCollision(collision, params);
+            bool apply = true;
+            if (callback && (collision.a->notifyCollisions() || collision.b->notifyCollisions())) {
+                apply = callback(collision, resolved.first, resolved.second);
+            }
+            if (apply) {
+                resolved.first.apply_impulse();
+                resolved.second.apply_impulse();
+            }
+            events.push_back({index(collision.a), index(collision.b), collision.time, collision.touch_point,
+                              collision.normal, apply ? resolved.first.impulse : Vec{}});
+            // Skipped collisions would be found again straight away, so ignore the pair until they separate
+            finishedCollision(collision, apply);
+        }
+    }
+    catch (...) {
+        step_events = nullptr;
+        throw;
+    }
+    step_events = nullptr;
+    endFrame();
+    return events;
+}
+
 void World::finishedCollision(const UnresolvedCollision& collision, bool renotify) {
-    ignore_current_collision[make_body_pair(collision.a.get(), collision.b.get())] = !renotify;
-    auto pred = [this](const tuple<CollisionTimeResult, Shape*, Body*, Shape*, Body*>& col)
-                {return changed_bodies.count(get<2>(col)) || changed_bodies.count(get<4>(col));};
-    collision_times.erase(remove_if(collision_times.begin(), collision_times.end(), pred), collision_times.end());
+    // Either body may have been removed while handling the collision
+    if (collision.a->_world_slot != -1 && collision.b->_world_slot != -1) {
+        ignore_current_collision.set(_slot(collision.a.get()).id, _slot(collision.b.get()).id, !renotify);
+    }
+    for (auto body : changed_bodies) {
+        collision_queue.removeBody(body);
+    }
     _updateCollisionTimes(false);
 }
 
@@ -195,7 +396,14 @@ void World::_updateBodySensorView(Body* body) {
     swap(old_scan, body->_sensor_view);
     vector<SensedObject>& new_scan = body->_sensor_view;
     bool has_indentifier;
-    for (const auto& sig : sigobjs) {
+    vector<unsigned int> in_range;
+    if (body->_sensors.size()) {
+        sigobj_tree.query(body->position(), body->maxSensorRange(), in_range);
+        // Same order as a scan over sigobjs, so the shuffle below gives the same view
+        sort(in_range.begin(), in_range.end());
+    }
+    for (auto index : in_range) {
+        const auto& sig = sigobjs[index];
         if (sig.body == body) {
             continue;
         }
@@ -244,20 +452,24 @@ void World::_updateBodySensorView(Body* body) {
     auto cmp = [](const SensedObject& l, const SensedObject& r){return l.position.x < r.position.x;};
     sort(old_scan.begin(), old_scan.end(), cmp);
     for (OldScanMergeCmp cmp2{16}; cmp2.search_radius <= 1024 && new_scan_copy.size() && old_scan.size(); cmp2.search_radius <<= 1) {
-        for (auto& so : new_scan_copy) {
+        for (auto iter = new_scan_copy.begin(); iter != new_scan_copy.end();) {
+            auto so = *iter;
             auto start = lower_bound(old_scan.begin(), old_scan.end(), so, cmp2);
             auto end = upper_bound(start, old_scan.end(), so, cmp2);
+            bool matched = false;
             for (; start != end; ++start) {
                 if (fabs(start->position.y - so->position.y) > cmp2.search_radius) {
                     continue;
                 }
                 if (so->signature.approx_equals(start->signature, 0.9)) {
                     so->velocity = so->position - start->position - start->velocity * frame_time;
-                    new_scan_copy.erase(so);
                     old_scan.erase(start);
+                    matched = true;
                     break;
                 }
             }
+            // Erase through the iterator, the set is being walked
+            iter = matched ? new_scan_copy.erase(iter) : next(iter);
         }
     }
 }
@@ -265,3 +477,7 @@ void World::_updateBodySensorView(Body* body) {
 void ResolvedCollision::apply_impulse() {
     body->applyImpulse(impulse, touch_point);
 }
+
+bool CollisionEvent::operator==(const CollisionEvent& other) const {
+    return tie(a, b, time, touch_point, normal, impulse) == tie(other.a, other.b, other.time, other.touch_point, other.normal, other.impulse);
+}
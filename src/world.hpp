@@ -22,14 +22,17 @@
 
 #include <vector>
 #include <utility>
-#include <map>
-#include <set>
 #include <memory>
+#include <functional>
 
 #include "body.hpp"
 #include "vec.hpp"
-#include "sataxes.hpp"
+#include "broadphase.hpp"
 #include "collisions.hpp"
+#include "collisionqueue.hpp"
+#include "threadpool.hpp"
+#include "kdtree.hpp"
+#include "pairflags.hpp"
 
 namespace shyphe {
     struct UnresolvedCollision {
@@ -52,9 +55,37 @@ namespace shyphe {
         void apply_impulse();
     };
 
+    // A collision resolved by World::step, impulse is the one applied to a (b receives -impulse). a and b are
+    // indexes into World::bodies() once step returns, -1 for a body removed during the step.
+    struct CollisionEvent {
+        long a;
+        long b;
+
+        double time;
+        Vec touch_point;
+        Vec normal;
+        Vec impulse;
+
+        bool operator==(const CollisionEvent& other) const;
+    };
+
+    // Called by World::step for collisions involving a body with notifyCollisions set. The impulses may be
+    // changed, and returning false leaves both bodies alone.
+    typedef std::function<bool(const UnresolvedCollision&, ResolvedCollision&, ResolvedCollision&)> CollisionCallback;
+
+    struct BodySlot {
+        Body* body;
+        double time;
+        unsigned long id;
+        bool changed;
+        std::size_t index; // In bodies()
+    };
+
     class World {
     public:
-        World(double frame_time_=1);
+        // cell_size is the spatial hash's cell size, 0 to choose it from the bodies' sizes. Other broadphases ignore it.
+        World(double frame_time_=1, BroadphaseType broadphase_type=BroadphaseType::sat_axes, double cell_size=0);
+        ~World();
         void addBody(std::shared_ptr<Body> body);
         void removeBody(std::shared_ptr<Body> body);
         void beginFrame();
@@ -63,20 +94,58 @@ namespace shyphe {
         void finishedCollision(const UnresolvedCollision& collision, bool renotify);
         bool hasNextCollision();
         void endFrame();
+        // Runs a whole frame, resolving every collision with params
+        std::vector<CollisionEvent> step(const CollisionParameters& params, const CollisionCallback& callback={});
         const std::vector<std::shared_ptr<Body>>& bodies() const {
             return _bodies;
         }
+        // Write the state of every body into out, in the order of bodies(). positions and velocities take
+        // 2 doubles per body (x, y), angles 1 and aabbs 4 (min_x, max_x, min_y, max_y, in world coordinates).
+        void writePositions(double* out) const;
+        void writeVelocities(double* out) const;
+        void writeAngles(double* out) const;
+        void writeAABBs(double* out, double time) const;
+        inline unsigned int threads() const {
+            return thread_pool ? thread_pool->size() : 1;
+        }
+        void setThreads(unsigned int threads);
+        inline TOISolver toiSolver() const {
+            return toi_solver;
+        }
+        inline void setTOISolver(TOISolver solver) {
+            toi_solver = solver;
+        }
+        // Collision time queries since the start of the frame, counted per pair of bodies
+        inline const TOIStats& toiStats() const {
+            return toi_stats;
+        }
     private:
         double time_until = 0, current_time = 0, frame_time;
         std::vector<std::shared_ptr<Body>> _bodies;
         std::vector<SigObject> sigobjs;
-        std::map<Body*, double> body_times;
-        std::set<Body*> changed_bodies, removed_bodies;
-        std::map<std::pair<Body*, Body*>, bool> ignore_current_collision;
-        std::vector<std::tuple<CollisionTimeResult, Shape*, Body*, Shape*, Body*>> collision_times;
-        SATAxes sat_axes;
+        KDTree sigobj_tree;
+        // Per-body bookkeeping, indexed by Body::_world_slot
+        std::vector<BodySlot> body_slots;
+        std::vector<int> free_slots;
+        unsigned long next_body_id = 0;
+        std::vector<Body*> changed_bodies;
+        // Keyed by BodySlot::id, as slots are reused
+        PairFlags ignore_current_collision;
+        CollisionQueue collision_queue;
+        std::unique_ptr<Broadphase> broadphase;
+        std::unique_ptr<ThreadPool> thread_pool;
+        TOISolver toi_solver = TOISolver::conservative;
+        TOIStats toi_stats;
+        // The events of the running step, renumbered as bodies are removed
+        std::vector<CollisionEvent>* step_events = nullptr;
+
+        inline BodySlot& _slot(Body* body) {
+            return body_slots[body->_world_slot];
+        }
 
+        void _markChanged(Body* body);
         void _updateCollisionTimes(bool initial);
+        void _orderPairs(std::vector<std::pair<Body*, Body*>>& pairs);
         void _updateBodySensorView(Body* body);
     };
 }
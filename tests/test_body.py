@@ -14,6 +14,8 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import math
+
 import pytest
 
 
@@ -36,6 +38,74 @@ def test_remove_shape(shyphe):
     assert b.mass == 0
 
 
+def test_bounding_radius(shyphe):
+    b = shyphe.Body()
+    b.add_shape(shyphe.Circle(radius=1, position=(3, 4), mass=1))
+    b.add_shape(shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1))
+    b.add_shape(shyphe.MassShape(mass=10, position=(100, 0)))
+
+    assert b.bounding_radius == pytest.approx(6)
+
+
+def test_shape_changes(shyphe):
+    b = shyphe.Body()
+    c = shyphe.Circle(radius=1, position=(1, 0), mass=2)
+    b.add_shape(c)
+
+    assert b.mass == 2
+    assert b.moment_of_inertia == pytest.approx(3)
+    assert b.bounding_radius == pytest.approx(2)
+
+    c.mass = 4
+    c.radius = 2
+    assert b.mass == 4
+    assert b.moment_of_inertia == pytest.approx(12)
+    assert b.bounding_radius == pytest.approx(3)
+    assert b.aabb(0).max_x == pytest.approx(3)
+
+
+def test_shared_shape_changes(shyphe):
+    b1 = shyphe.Body()
+    b2 = shyphe.Body()
+    b3 = shyphe.Body()
+    c = shyphe.Circle(radius=1, mass=2)
+    b1.add_shape(c)
+    b2.add_shape(c)
+    b3.add_shape(shyphe.Circle(radius=1, mass=5))
+
+    c.mass = 3
+    assert b1.mass == b2.mass == 3
+    assert b3.mass == 5
+
+    b1.remove_shape(c)
+    del b2
+    c.mass = 4
+    assert b1.mass == 0
+    assert b3.mass == 5
+
+
+@pytest.mark.parametrize("spin,torque", [(0, 0), (2, 0), (0, 0.5), (-3, 0.2)])
+def test_collide_shapes_matches_update(shyphe, spin, torque):
+    # collide_shapes moves the bodies with KinematicState.update, Body.update must take them to the same touch
+    b1 = shyphe.Body(position=(0, 0), velocity=(1, 0), angle=0.5, angular_velocity=spin)
+    b1.add_shape(shyphe.Circle(radius=1, mass=2))
+    arm = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], position=(2, 0), mass=1)
+    b1.add_shape(arm)
+    b1.apply_global_force((0.5, 0.2), (0, 0))
+    b1.apply_local_force((0.2, 0.1), (0, torque))
+    b2 = shyphe.Body(position=(6, 0.5))
+    target = shyphe.Circle(radius=1, mass=1)
+    b2.add_shape(target)
+
+    coll = shyphe.collide_shapes(arm, b1, target, b2, 4, False)
+    assert coll.time > 0
+    b1.update(coll.time)
+    b2.update(coll.time)
+    dist = shyphe.distance_between(arm, b1, target, b2)
+    assert abs(dist.distance) < 1e-6
+    assert ((dist.a_point + dist.b_point) / 2).as_tuple() == pytest.approx(coll.touch_point.as_tuple())
+
+
 def test_state(shyphe):
     b1 = shyphe.Body(position=(1, 2), velocity=(3, 4), angle=5, angular_velocity=6)
     b1.add_shape(shyphe.MassShape(mass=10))
@@ -96,6 +166,38 @@ def test_body_collide(shyphe):
     assert colr.time == pytest.approx(1.0)
 
 
+def make_compound(shyphe, position, velocity, angular_velocity):
+    body = shyphe.Body(position=position, velocity=velocity, angular_velocity=angular_velocity)
+    for i in range(36):
+        x, y = i % 6 * 3 - 7.5, i // 6 * 3 - 7.5
+        if i % 2:
+            body.add_shape(shyphe.Circle(radius=1, position=(x, y), mass=1))
+        else:
+            body.add_shape(shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], position=(x, y), mass=1))
+    return body
+
+
+def test_compound_bodies(shyphe):
+    b1 = make_compound(shyphe, (0, 0), (10, 0), 0.3)
+    b2 = make_compound(shyphe, (30, 4), (-10, 0), -0.2)
+
+    distances = [shyphe.distance_between(s1, b1, s2, b2).distance for s1 in b1.shapes for s2 in b2.shapes]
+    assert b1.distance_between(b2) == min(distances)
+
+    colls = [(shyphe.collide_shapes(s1, b1, s2, b2, 2, False).time, s1, s2) for s1 in b1.shapes for s2 in b2.shapes]
+    time, s1, s2 = min((c for c in colls if c[0] != -1), key=lambda c: c[0])
+    colr, a, b = b1.collide(b2, 2, False)
+    assert colr.time == time
+    assert a.position == s1.position and b.position == s2.position
+    assert colr.culled > 300
+
+    # Moving a shape rebuilds the tree
+    b2.shapes[0].position = (-24, -4)
+    distances = [shyphe.distance_between(s1, b1, s2, b2).distance for s1 in b1.shapes for s2 in b2.shapes]
+    assert min(distances) < 0
+    assert b1.distance_between(b2) == min(distances)
+
+
 def test_body_accelerating_collide(shyphe):
     b1 = shyphe.Body(position=(0, 0), velocity=(1, 0))
     b1.add_shape(shyphe.Circle(radius=1, position=(0, 0), mass=1))
@@ -243,6 +345,42 @@ def test_combined_acceleration(shyphe):
 
     # TODO: This needs a test, but I don't know what the answer is meant to be...
 
+
+def test_spinning_local_force(shyphe):
+    b = shyphe.Body(angular_velocity=math.pi)
+    b.add_shape(shyphe.MassShape(mass=2))
+    b.apply_local_force((2, 0), (0, 0))
+
+    b.update(1)
+
+    assert b.angle == pytest.approx(math.pi)
+    assert b.velocity.as_tuple() == pytest.approx((0, -2 / math.pi))
+    assert b.position.as_tuple() == pytest.approx((2 / math.pi ** 2, -1 / math.pi))
+
+
+def test_strips_per_second(shyphe):
+    results = []
+    for strips in (100, 10000):
+        b = shyphe.Body(angular_velocity=1)
+        b.add_shape(shyphe.MassShape(mass=1))
+        b.strips_per_second = strips
+        assert b.strips_per_second == strips
+        b.apply_local_force((1, 0), (0, 1))
+        b.update(2)
+        results.append(b.position.as_tuple() + b.velocity.as_tuple())
+
+    assert results[0] == pytest.approx(results[1], rel=1e-3)
+
+    for strips in (0, -1, math.nan, math.inf):
+        with pytest.raises(RuntimeError):
+            b.strips_per_second = strips
+
+    # The strip count is capped, rather than overflowing
+    b.strips_per_second = 1e300
+    b.update(1)
+    assert all(math.isfinite(x) for x in b.position.as_tuple() + b.velocity.as_tuple())
+
+
 def test_aabb(shyphe):
     b = shyphe.Body()
     c = shyphe.Circle(radius=1, mass=1)
@@ -284,3 +422,22 @@ def test_aabb(shyphe):
     # assert b.aabb(2).as_tuple() == pytest.approx((-1, 3, -1, 2))
     # assert b.aabb(3).as_tuple() == (-2 ** -0.5 - 1, 2, -1, 2)
     # assert b.aabb(4).as_tuple() == pytest.approx((-2, 4, -1, 2))
+
+
+def test_compound_aabb(shyphe):
+    b = shyphe.Body(angle=shyphe.to_rad(90))
+    square = [(-1, -1), (-1, 1), (1, 1), (1, -1)]
+    b.add_shape(shyphe.Polygon(points=square, mass=1, position=(4, 0)))
+    # Inside the hull of the other polygons, so never the widest point
+    b.add_shape(shyphe.Polygon(points=square, mass=1, position=(2, 0)))
+    b.add_shape(shyphe.Polygon(points=square, mass=1, position=(0, 0)))
+    circle = shyphe.Circle(radius=1, mass=1, position=(0, 3))
+    b.add_shape(circle)
+
+    assert b.aabb(0).as_tuple() == pytest.approx((-1, 4, -5, 1))
+    assert b.aabb(1).as_tuple() == pytest.approx((-1, 4, -5, 1))
+
+    circle.position = (0, 5)
+    assert b.aabb(0).as_tuple() == pytest.approx((-1, 6, -5, 1))
+    b.remove_shape(circle)
+    assert b.aabb(0).as_tuple() == pytest.approx((-1, 1, -5, 1))
@@ -14,6 +14,8 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import math
+import random
 import pytest
 
 
@@ -134,6 +136,32 @@ def test_distance_between_rotated(shyphe):
     assert shyphe.distance_between(c, b1, p, b2).distance == pytest.approx(-1 - 2 ** -0.5)
 
 
+def test_distance_between_rotated_offset(shyphe):
+    # Compare against rotating every vertex separately, with the shapes away from their bodies' centres
+    def segment_distance(point, l1, l2):
+        edge = l2 - l1
+        t = max(0, min(1, (point - l1).dot(edge) / edge.dot(edge)))
+        return (point - (l1 + edge * t)).abs()
+
+    rng = random.Random(1)
+    points = [(2 * math.cos(i * 2 * math.pi / 7), math.sin(i * 2 * math.pi / 7)) for i in range(7)]
+    for _ in range(50):
+        b1 = shyphe.Body(position=(rng.uniform(-5, 5), rng.uniform(-5, 5)), angle=rng.uniform(-4, 4))
+        c = shyphe.Circle(radius=0.5, position=(1, 0.5), mass=1)
+        b1.add_shape(c)
+        b2 = shyphe.Body(position=(rng.uniform(-5, 5), rng.uniform(-5, 5)), angle=rng.uniform(-4, 4))
+        p = shyphe.Polygon(points=points, position=(0.5, -1), mass=1)
+        b2.add_shape(p)
+
+        centre = b1.position + c.position.rotate(b1.angle)
+        vertices = [b2.position + (p.position + shyphe.Vec(*point)).rotate(b2.angle) for point in points]
+        edge_distance = min(segment_distance(centre, vertices[i], vertices[(i + 1) % 7]) for i in range(7))
+        db = shyphe.distance_between(c, b1, p, b2)
+        if db.distance > 0:
+            assert db.distance == pytest.approx(edge_distance - 0.5)
+            assert (db.b_point - db.a_point).abs() == pytest.approx(db.distance)
+
+
 def test_circle_polygon_horizontal(shyphe):
     b1 = shyphe.Body(position=(0, 0), velocity=(2, 0))
     c = shyphe.Circle(radius=1, mass=1)
@@ -227,3 +255,20 @@ def test_circle_polygon_out_of_time(shyphe):
 
     coll = shyphe.collide_shapes(c, b1, p, b2, 1, False)
     assert coll.time == -1.0
+
+
+def test_circle_polygon_spinning_bilateral(shyphe):
+    b1 = shyphe.Body(position=(8, -2), velocity=(30, 1))
+    c = shyphe.Circle(radius=1, mass=1)
+    b1.add_shape(c)
+
+    b2 = shyphe.Body(position=(0, 0), angular_velocity=20, angle=-1)
+    p = shyphe.Polygon(points=[(-10, 1), (-10, -1), (10, -1), (10, 1)], mass=1, position=(10, 0))
+    b2.add_shape(p)
+
+    coll = shyphe.collide_shapes(c, b1, p, b2, 1.5, False)
+    bilateral = shyphe.collide_shapes(c, b1, p, b2, 1.5, False, shyphe.TOISolver.bilateral)
+    assert coll.time > 0
+    assert bilateral.time == pytest.approx(coll.time)
+    assert bilateral.touch_point.as_tuple() == pytest.approx(coll.touch_point.as_tuple(), abs=1e-6)
+    assert bilateral.iterations < coll.iterations / 2
@@ -14,6 +14,9 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import math
+import random
+
 import pytest
 
 
@@ -81,6 +84,129 @@ def test_distance_between_square_square(shyphe):
     assert shyphe.distance_between(p1, b1, p2, b2).distance == pytest.approx(2 ** 0.5)
 
 
+def test_distance_between_offset_squares(shyphe):
+    b1 = shyphe.Body(position=(0, 0))
+    p1 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
+    b1.add_shape(p1)
+
+    b2 = shyphe.Body(position=(1.5, 3))
+    p2 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
+    b2.add_shape(p2)
+
+    # The faces overlap between x = 0.5 and x = 1, so touch in the middle of that
+    for a, ba, b, bb, normal in [(p1, b1, p2, b2, (0, 1)), (p2, b2, p1, b1, (0, -1))]:
+        db = shyphe.distance_between(a, ba, b, bb)
+        assert db.distance == pytest.approx(1)
+        assert db.normal.as_tuple() == pytest.approx(normal)
+        assert db.a_point.x == db.b_point.x == pytest.approx(0.75)
+
+
+def test_distance_between_many_sided(shyphe):
+    points = [(2 * math.cos(i * math.pi / 16), 2 * math.sin(i * math.pi / 16)) for i in range(32)]
+    b1 = shyphe.Body(position=(0, 0))
+    p1 = shyphe.Polygon(points=points, mass=1)
+    b1.add_shape(p1)
+
+    b2 = shyphe.Body(position=(10, 0))
+    p2 = shyphe.Polygon(points=points, mass=1)
+    b2.add_shape(p2)
+
+    # Repeated queries on the same pair start from the last closest features
+    for x in [10, 8, 6, 4.5, 7, 12]:
+        b2.teleport((x, 0))
+        db = shyphe.distance_between(p1, b1, p2, b2)
+        assert db.distance == pytest.approx(x - 4)
+        assert db.normal.as_tuple() == pytest.approx((1, 0))
+        assert db.a_point.as_tuple() == pytest.approx((2, 0))
+        assert db.b_point.as_tuple() == pytest.approx((x - 2, 0))
+
+    b2.teleport((3, 0))
+    assert shyphe.distance_between(p1, b1, p2, b2).distance == pytest.approx(-1, abs=0.01)
+
+    b2.teleport((0, 10))
+    db = shyphe.distance_between(p1, b1, p2, b2)
+    assert db.distance == pytest.approx(6)
+    assert db.normal.as_tuple() == pytest.approx((0, 1))
+
+
+def test_distance_between_large_polygons(shyphe):
+    points = [(2 * math.cos(i * math.pi / 128), 2 * math.sin(i * math.pi / 128)) for i in range(256)]
+    b1 = shyphe.Body(position=(0, 0))
+    p1 = shyphe.Polygon(points=points, mass=1)
+    b1.add_shape(p1)
+
+    b2 = shyphe.Body(position=(10, 0), angle=1)
+    p2 = shyphe.Polygon(points=points, mass=1)
+    b2.add_shape(p2)
+
+    # Walk the closest points round both polygons, in both directions and past the first point
+    for i in list(range(0, 40, 3)) + list(range(40, -40, -7)):
+        direction = shyphe.Vec(math.cos(i / 5), math.sin(i / 5))
+        for gap, distance in [(10, 6), (3, -1)]:
+            b2.teleport((direction * gap).as_tuple())
+            db = shyphe.distance_between(p1, b1, p2, b2)
+            assert db.distance == pytest.approx(distance, abs=0.01)
+            assert db.normal.as_tuple() == pytest.approx(direction.as_tuple(), abs=0.05)
+
+
+@pytest.mark.parametrize("count", [3, 4, 5, 7, 8, 9, 16, 33])
+def test_distance_between_point_counts(shyphe, count):
+    # Point counts which fill the vector lanes of the projections, and which leave a scalar tail
+    def segment_distance(point, l1, l2):
+        edge = l2 - l1
+        t = max(0, min(1, (point - l1).dot(edge) / edge.dot(edge)))
+        return (point - (l1 + edge * t)).abs()
+
+    def vertices(body, points):
+        return [body.position + shyphe.Vec(*point).rotate(body.angle) for point in points]
+
+    rng = random.Random(count)
+    for _ in range(20):
+        # Clockwise points on circles, at distinct angles so none are collinear
+        shapes = []
+        for _ in range(2):
+            radius = rng.uniform(0.5, 3)
+            angles = sorted(rng.sample(range(360), count), reverse=True)
+            shapes.append([(radius * math.cos(math.radians(a)), radius * math.sin(math.radians(a))) for a in angles])
+        b1 = shyphe.Body(position=(0, 0), angle=rng.uniform(-4, 4))
+        p1 = shyphe.Polygon(points=shapes[0], mass=1)
+        b1.add_shape(p1)
+        direction = rng.uniform(-4, 4)
+        b2 = shyphe.Body(position=(8 * math.cos(direction), 8 * math.sin(direction)), angle=rng.uniform(-4, 4))
+        p2 = shyphe.Polygon(points=shapes[1], mass=1)
+        b2.add_shape(p2)
+
+        v1, v2 = vertices(b1, shapes[0]), vertices(b2, shapes[1])
+        expected = min(segment_distance(point, edge[i], edge[(i + 1) % count])
+                       for points, edge in [(v1, v2), (v2, v1)] for point in points for i in range(count))
+        db = shyphe.distance_between(p1, b1, p2, b2)
+        assert db.distance == pytest.approx(expected)
+        assert (db.b_point - db.a_point).abs() == pytest.approx(expected)
+
+
+@pytest.mark.parametrize("angle", [0, 0.5, -2])
+def test_distance_between_parallel_faces(shyphe, angle):
+    # Faces touching to within the collision limit, including each square's edge from its last point to its first. The
+    # sign of the distance must not depend on the order of the arguments.
+    points = [(-1, -1), (-1, 1), (1, 1), (1, -1)]
+    for side in range(4):
+        for gap in [-5e-9, -1e-9, 0, 1e-9, 5e-9]:
+            for slide in [-0.5, 0, 0.7]:
+                offset = shyphe.Vec(slide, 2 + gap).rotate(angle + side * math.pi / 2)
+                b1 = shyphe.Body(position=(0, 0), angle=angle)
+                p1 = shyphe.Polygon(points=points, mass=1)
+                b1.add_shape(p1)
+                b2 = shyphe.Body(position=offset.as_tuple(), angle=angle)
+                p2 = shyphe.Polygon(points=points, mass=1)
+                b2.add_shape(p2)
+
+                forward = shyphe.distance_between(p1, b1, p2, b2)
+                backward = shyphe.distance_between(p2, b2, p1, b1)
+                assert forward.distance == pytest.approx(gap, abs=1e-12)
+                assert backward.distance == pytest.approx(gap, abs=1e-12)
+                assert forward.normal.as_tuple() == pytest.approx((-backward.normal).as_tuple())
+
+
 def test_distance_between_square_triangle(shyphe):
     b1 = shyphe.Body(position=(0, 0))
     p1 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
@@ -173,6 +299,23 @@ def test_square_square_horizontal(shyphe):
     assert coll.touch_point.as_tuple() == pytest.approx((3, 0))
 
 
+def test_square_square_horizontal_bilateral(shyphe):
+    b1 = shyphe.Body(position=(0, 0), velocity=(2, 0), angular_velocity=0.1)
+    p1 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
+    b1.add_shape(p1)
+
+    b2 = shyphe.Body(position=(10, 0), velocity=(-6, 0))
+    p2 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
+    b2.add_shape(p2)
+
+    coll = shyphe.collide_shapes(p1, b1, p2, b2, 1.5, False)
+    bilateral = shyphe.collide_shapes(p1, b1, p2, b2, 1.5, False, shyphe.TOISolver.bilateral)
+    assert bilateral.time == pytest.approx(coll.time)
+    assert bilateral.normal.as_tuple() == pytest.approx(coll.normal.as_tuple(), abs=1e-5)
+    assert bilateral.touch_point.as_tuple() == pytest.approx(coll.touch_point.as_tuple(), abs=1e-5)
+    assert 0 < bilateral.iterations <= coll.iterations
+
+
 def test_square_square_vertical(shyphe):
     b1 = shyphe.Body(position=(0, 0), velocity=(0, 2))
     p1 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
@@ -253,3 +396,18 @@ def test_square_square_out_of_time(shyphe):
 
     coll = shyphe.collide_shapes(p1, b1, p2, b2, 1, False)
     assert coll.time == -1.0
+
+
+def test_distance_between_unsupported(shyphe):
+    b1 = shyphe.Body(position=(0, 0))
+    p1 = shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1)
+    b1.add_shape(p1)
+
+    b2 = shyphe.Body(position=(10, 0))
+    m2 = shyphe.MassShape(mass=1)
+    b2.add_shape(m2)
+
+    with pytest.raises(IndexError):
+        shyphe.distance_between(p1, b1, m2, b2)
+    with pytest.raises(IndexError):
+        shyphe.distance_between(m2, b2, p1, b1)
@@ -546,3 +546,388 @@ def test_bodies(shyphe):
 
     assert c.bodies[0] is b1
     assert list(c.bodies) == [b1, b2, b3, b4, b5]
+
+    c.remove_body(b2)
+    c.remove_body(b4)
+    c.add_body(b2)
+
+    assert list(c.bodies) == [b1, b3, b5, b2]
+
+    with pytest.raises(RuntimeError):
+        c.add_body(b1)
+    with pytest.raises(RuntimeError):
+        shyphe.World(1).add_body(b1)
+
+    del c
+    shyphe.World(1).add_body(b1)
+
+
+def test_readded_body(shyphe):
+    b1 = shyphe.Body(position=(0, 0), velocity=(4, 0))
+    b1.add_shape(shyphe.Circle(radius=1, mass=1))
+
+    b2 = shyphe.Body(position=(4, 0), velocity=(0, 0))
+    b2.add_shape(shyphe.Circle(radius=1, mass=1))
+
+    b3 = shyphe.Body(position=(20, 0), velocity=(0, 0))
+    b3.add_shape(shyphe.Circle(radius=1, mass=1))
+
+    c = shyphe.World(2)
+    c.add_body(b1)
+    c.add_body(b2)
+    c.add_body(b3)
+    c.begin_frame()
+
+    ctr = c.next_collision()
+    c.remove_body(b2)
+    c.finished_collision(ctr, True)
+
+    assert not c.has_next_collision()
+
+    c.end_frame()
+    b2.teleport((b1.position.x + 4, 0))
+    c.add_body(b2)
+    c.begin_frame()
+
+    assert c.has_next_collision()
+
+    ctr = c.next_collision()
+
+    assert (ctr.a, ctr.b) == (b1, b2) or (ctr.b, ctr.a) == (b1, b2)
+
+
+def resolve(shyphe, world, ctr):
+    for col in world.calculate_collision(ctr, shyphe.CollisionParameters(1)):
+        col.apply_impulse()
+    world.finished_collision(ctr, True)
+
+
+def run_collisions(shyphe, world, bodies):
+    # Resolve a frame's collisions, as the indexes of the bodies and the time of each
+    collisions = []
+    world.begin_frame()
+    while world.has_next_collision():
+        ctr = world.next_collision()
+        resolve(shyphe, world, ctr)
+        collisions.append((sorted([bodies.index(ctr.a), bodies.index(ctr.b)]), ctr.time))
+    world.end_frame()
+    return collisions
+
+
+def pair_world(shyphe, times):
+    # Pairs of circles far apart from each other, pair i touching at times[i]
+    bodies = []
+    for i, time in enumerate(times):
+        for position, velocity in [((0, i * 10), (1, 0)), ((2 + 2 * time, i * 10), (-1, 0))]:
+            body = shyphe.Body(position=position, velocity=velocity)
+            body.add_shape(shyphe.Circle(radius=1, mass=1))
+            bodies.append(body)
+    world = shyphe.World(1)
+    for body in bodies:
+        world.add_body(body)
+    return world, bodies
+
+
+def test_collision_order(shyphe):
+    world, bodies = pair_world(shyphe, [0.6, 0.2, 0.4, 0.2])
+    collisions = run_collisions(shyphe, world, bodies)
+    assert [time for _, time in collisions] == pytest.approx([0.2, 0.2, 0.4, 0.6])
+    # The pairs touching at the same time are both reported, once each
+    assert sorted(pair for pair, _ in collisions[:2]) == [[2, 3], [6, 7]]
+    assert [pair for pair, _ in collisions[2:]] == [[4, 5], [0, 1]]
+
+
+def test_remove_body_pending(shyphe):
+    world, bodies = pair_world(shyphe, [0.2, 0.4, 0.6])
+    world.begin_frame()
+    ctr = world.next_collision()
+    assert ctr.time == pytest.approx(0.2)
+    resolve(shyphe, world, ctr)
+
+    # The removed body's pending collision is dropped, the others are left alone
+    world.remove_body(bodies[3])
+    ctr = world.next_collision()
+    assert sorted([bodies.index(ctr.a), bodies.index(ctr.b)]) == [4, 5]
+    assert ctr.time == pytest.approx(0.6)
+    resolve(shyphe, world, ctr)
+    assert not world.has_next_collision()
+
+
+def test_stale_collision(shyphe):
+    # b2 and b3 would touch at 0.75, but b1 knocks b2 into b3 first
+    b1 = shyphe.Body(position=(0, 0), velocity=(4, 0))
+    b2 = shyphe.Body(position=(4, 0), velocity=(-4, 0))
+    b3 = shyphe.Body(position=(9, 0), velocity=(-8, 0))
+    bodies = [b1, b2, b3]
+    world = shyphe.World(1)
+    for body in bodies:
+        body.add_shape(shyphe.Circle(radius=1, mass=1))
+        world.add_body(body)
+
+    collisions = run_collisions(shyphe, world, bodies)
+    assert [pair for pair, _ in collisions] == [[0, 1], [1, 2], [0, 1]]
+    assert [time for _, time in collisions] == pytest.approx([0.25, 0.25 + 1 / 6, 0.75])
+    assert [body.velocity.x for body in bodies] == pytest.approx([-8, -4, 4])
+
+
+def run_convoy(shyphe, broadphase, threads=1, toi_solver=None, step=False, cell_size=0):
+    world = shyphe.World(1, broadphase, cell_size)
+    world.threads = threads
+    if toi_solver is not None:
+        world.toi_solver = toi_solver
+    bodies = []
+    for i in range(10):
+        body = shyphe.Body(position=(i * 3, 0), velocity=(1, 0))
+        body.add_shape(shyphe.Circle(radius=1, mass=1))
+        bodies.append(body)
+    for i in range(3):
+        body = shyphe.Body(position=(40 + i * 5, 0.5 * i), velocity=(-10, 0), angular_velocity=0.5)
+        body.add_shape(shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=2))
+        bodies.append(body)
+    bodies[1].apply_global_force((0, 0.1), (0, 0.5))
+    bodies[4].apply_local_force((0.2, 0), (0, 0))
+    bodies[11].apply_global_force((0.5, 0), (0, 1))
+    for body in bodies:
+        world.add_body(body)
+
+    times = []
+    for _ in range(5):
+        if step:
+            times.extend(world.step(shyphe.CollisionParameters(1)).tolist()[2::9])
+            continue
+        world.begin_frame()
+        while world.has_next_collision():
+            ctr = world.next_collision()
+            cola, colb = world.calculate_collision(ctr, shyphe.CollisionParameters(1))
+            cola.apply_impulse()
+            colb.apply_impulse()
+            times.append(ctr.time)
+            world.finished_collision(ctr, True)
+        world.end_frame()
+    return sorted(times), [body.position.as_tuple() + (body.angle,) for body in bodies]
+
+
+@pytest.mark.parametrize("broadphase,cell_size",
+                         [("aabb_tree", 0), ("spatial_hash", 0), ("spatial_hash", 0.5), ("spatial_hash", 20)])
+def test_broadphase_matches_sat_axes(shyphe, broadphase, cell_size):
+    sat_times, sat_positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes)
+    times, positions = run_convoy(shyphe, getattr(shyphe.BroadphaseType, broadphase), cell_size=cell_size)
+    assert len(sat_times) > 10
+    assert times == pytest.approx(sat_times)
+    for pos, sat_pos in zip(positions, sat_positions):
+        assert pos == pytest.approx(sat_pos)
+
+
+def test_spatial_hash_far_bodies(shyphe):
+    # Cell coordinates this far out do not fit in an int
+    world = shyphe.World(1, shyphe.BroadphaseType.spatial_hash, 1)
+    bodies = []
+    for position in [(1e300, 0), (-1e300, 1e300), (1e12, 1e12), (0, 0), (2.5, 0)]:
+        body = shyphe.Body(position=position, velocity=(-1, 0) if position == (2.5, 0) else (0, 0))
+        body.add_shape(shyphe.Circle(radius=1, mass=1))
+        world.add_body(body)
+        bodies.append(body)
+
+    world.begin_frame()
+    assert world.has_next_collision()
+    ctr = world.next_collision()
+    assert (ctr.a, ctr.b) == (bodies[3], bodies[4]) or (ctr.b, ctr.a) == (bodies[3], bodies[4])
+
+
+@pytest.mark.parametrize("threads", [1, 4])
+def test_replay_matches(shyphe, threads):
+    serial_times, serial_positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes)
+    for _ in range(3):
+        times, positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes, threads=threads)
+        assert times == serial_times
+        assert positions == serial_positions
+
+
+def test_bilateral_matches_conservative(shyphe):
+    times, positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes)
+    bilateral_times, bilateral_positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes,
+                                                      toi_solver=shyphe.TOISolver.bilateral)
+    assert bilateral_times == pytest.approx(times, abs=1e-5)
+    for pos, bilateral_pos in zip(positions, bilateral_positions):
+        assert bilateral_pos == pytest.approx(pos, rel=1e-5, abs=1e-4)
+
+
+def test_toi_stats(shyphe):
+    times = []
+    for solver in [shyphe.TOISolver.conservative, shyphe.TOISolver.bilateral]:
+        c = shyphe.World(1)
+        assert c.toi_solver == shyphe.TOISolver.conservative
+        c.toi_solver = solver
+        assert c.toi_solver == solver
+        b1 = shyphe.Body(position=(0, 0), velocity=(2, 0), angular_velocity=1)
+        b1.add_shape(shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=1))
+        b2 = shyphe.Body(position=(4, 0))
+        b2.add_shape(shyphe.Circle(radius=1, mass=1))
+        c.add_body(b1)
+        c.add_body(b2)
+
+        c.begin_frame()
+        stats = c.toi_stats
+        assert stats.pairs == 1
+        assert stats.iterations == stats.max_iterations > 1
+        assert c.has_next_collision()
+        times.append(c.next_collision().time)
+    assert times[1] == pytest.approx(times[0])
+
+
+def test_culled_shape_pairs(shyphe):
+    c = shyphe.World(1)
+    b1 = shyphe.Body(position=(0, 0), velocity=(5, 0))
+    b2 = shyphe.Body(position=(10, 0), velocity=(-5, 0))
+    for body in [b1, b2]:
+        for y in [-4, 0, 4]:
+            body.add_shape(shyphe.Circle(radius=1, mass=1, position=(0, y)))
+    c.add_body(b1)
+    c.add_body(b2)
+
+    c.begin_frame()
+    # Only the shapes level with each other can meet
+    assert c.toi_stats.pairs == 1
+    assert c.toi_stats.culled == 6
+    assert c.has_next_collision()
+    assert c.next_collision().time == pytest.approx(0.8)
+
+
+def test_step_matches_loop(shyphe):
+    times, positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes)
+    step_times, step_positions = run_convoy(shyphe, shyphe.BroadphaseType.sat_axes, step=True)
+    assert step_times == times
+    assert step_positions == positions
+
+
+def test_step(shyphe):
+    b1 = shyphe.Body(position=(0, 0), velocity=(2, 0))
+    b1.add_shape(shyphe.Circle(radius=1, mass=1))
+    b2 = shyphe.Body(position=(8, 0), velocity=(-6, 0))
+    b2.add_shape(shyphe.Circle(radius=1, mass=1))
+    c = shyphe.World(1)
+    c.add_body(b1)
+    c.add_body(b2)
+
+    calls = []
+    events = c.step(shyphe.CollisionParameters(1), lambda *args: calls.append(args))
+    # Neither body asked to be notified
+    assert calls == []
+    assert events.format == "d"
+    assert len(events) == 9
+    a, b, time, tx, ty, nx, ny, ix, iy = events.tolist()
+    if a == 1:
+        ix, iy = -ix, -iy
+    assert sorted([a, b]) == [0, 1]
+    assert time == pytest.approx(0.75)
+    assert (tx, ty) == pytest.approx((2.5, 0))
+    assert abs(nx) == pytest.approx(1) and ny == pytest.approx(0)
+    assert (ix, iy) == pytest.approx((-8, 0))
+    assert b1.velocity.as_tuple() == pytest.approx((-6, 0))
+    assert b2.velocity.as_tuple() == pytest.approx((2, 0))
+
+    assert len(c.step(shyphe.CollisionParameters(1))) == 0
+
+
+def test_step_callback(shyphe):
+    b1 = shyphe.Body(position=(0, 0), velocity=(2, 0))
+    b1.add_shape(shyphe.Circle(radius=1, mass=1))
+    b2 = shyphe.Body(position=(8, 0), velocity=(-6, 0))
+    b2.add_shape(shyphe.Circle(radius=1, mass=1))
+    b2.notify_collisions = True
+    assert not b1.notify_collisions
+    c = shyphe.World(1)
+    c.add_body(b1)
+    c.add_body(b2)
+
+    calls = []
+
+    def callback(ctr, cola, colb):
+        calls.append((ctr, cola, colb))
+        cola.impulse = cola.impulse * 0.5
+        colb.impulse = colb.impulse * 0.5
+
+    events = c.step(shyphe.CollisionParameters(1), callback)
+    assert len(calls) == 1
+    assert len(events) == 9
+    assert b1.velocity.as_tuple() == pytest.approx((-2, 0))
+    assert b2.velocity.as_tuple() == pytest.approx((-2, 0))
+    assert abs(events[7]) == pytest.approx(4)
+    # The arguments are copies, so they can be kept after the callback returns
+    ctr, cola, colb = calls[0]
+    assert ctr.time == pytest.approx(0.75)
+    assert abs(cola.impulse.x) == pytest.approx(4)
+    assert {cola.body, colb.body} == {b1, b2}
+
+    b3 = shyphe.Body(position=(0, 0), velocity=(2, 0))
+    b3.add_shape(shyphe.Circle(radius=1, mass=1))
+    b4 = shyphe.Body(position=(8, 0), velocity=(-6, 0))
+    b4.add_shape(shyphe.Circle(radius=1, mass=1))
+    b4.notify_collisions = True
+    c = shyphe.World(1)
+    c.add_body(b3)
+    c.add_body(b4)
+
+    # Returning False leaves the bodies to pass through each other
+    events = c.step(shyphe.CollisionParameters(1), lambda ctr, cola, colb: False)
+    assert len(events) == 9
+    assert events.tolist()[7:] == [0, 0]
+    assert b3.velocity.as_tuple() == (2, 0)
+    assert b4.velocity.as_tuple() == (-6, 0)
+
+
+def test_step_remove_body(shyphe):
+    bodies = []
+    for position, velocity in [((0, 100), (2, 0)), ((4, 100), (-2, 0)), ((0, 0), (2, 0)), ((8, 0), (-6, 0))]:
+        body = shyphe.Body(position=position, velocity=velocity)
+        body.add_shape(shyphe.Circle(radius=1, mass=1))
+        bodies.append(body)
+    bodies[3].notify_collisions = True
+    c = shyphe.World(1)
+    for body in bodies:
+        c.add_body(body)
+
+    # The first collision is recorded before its body is removed, and renumbered afterwards
+    events = c.step(shyphe.CollisionParameters(1), lambda ctr, cola, colb: c.remove_body(bodies[0]))
+    events = events.tolist()
+    assert len(events) == 18
+    assert events[2] == pytest.approx(0.5) and events[11] == pytest.approx(0.75)
+    assert sorted(events[0:2]) == [-1, 0]
+    assert sorted(events[9:11]) == [1, 2]
+    assert list(c.bodies) == bodies[1:]
+
+
+def test_state_arrays(shyphe):
+    c = shyphe.World(1)
+    assert len(c.positions()) == len(c.angles()) == len(c.aabbs()) == 0
+    b1 = shyphe.Body(position=(1, 2), velocity=(3, 4), angle=0.5, angular_velocity=1)
+    b1.add_shape(shyphe.Polygon(points=[(-1, -1), (-1, 1), (1, 1), (1, -1)], mass=2))
+    b2 = shyphe.Body(position=(-5, 6), velocity=(-7, 0))
+    b2.add_shape(shyphe.Circle(radius=1, mass=1))
+    c.add_body(b1)
+    c.add_body(b2)
+
+    positions = c.positions()
+    assert positions.format == "d"
+    assert positions.tolist() == [1, 2, -5, 6]
+    assert c.velocities().tolist() == [3, 4, -7, 0]
+    assert c.angles().tolist() == [0.5, 0]
+    for time in [0, 0.5]:
+        aabbs = c.aabbs(time=time).tolist()
+        for i, body in enumerate(c.bodies):
+            aabb = body.aabb(time) + body.position
+            assert aabbs[i * 4:i * 4 + 4] == [aabb.min_x, aabb.max_x, aabb.min_y, aabb.max_y]
+
+    c.step(shyphe.CollisionParameters(1))
+    # A fresh copy is returned each time
+    assert positions.tolist() == [1, 2, -5, 6]
+    assert c.positions().tolist() == [4, 6, -12, 6]
+
+
+def test_threads(shyphe):
+    c = shyphe.World(1)
+    assert c.threads == 1
+    c.threads = 3
+    assert c.threads == 3
+    c.threads = 0
+    assert c.threads == 1
@@ -14,6 +14,8 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import math
+
 
 def test_active_radar(shyphe):
     b1 = shyphe.Body(position=(0, 0))
@@ -62,6 +64,30 @@ def test_out_of_range(shyphe):
     assert len(b1.sensor_view) == 0
 
 
+def test_range_ring(shyphe):
+    b1 = shyphe.Body(position=(5, -3))
+    s = shyphe.PassiveThermal(sensitivity=1)
+    b1.add_sensor(s)
+
+    w = shyphe.World(1)
+    w.add_body(b1)
+    inside = []
+    for i in range(40):
+        # Alternate just inside and just outside the range, all the way round
+        dist = s.max_range * (0.99 if i % 2 else 1.01)
+        b = shyphe.Body(position=(5 + dist * math.sin(i), -3 + dist * math.cos(i)))
+        b.add_shape(shyphe.MassShape(thermal_emissions=s.max_range * 2))
+        w.add_body(b)
+        if i % 2:
+            inside.append(b)
+
+    w.begin_frame()
+    w.end_frame()
+
+    assert len(b1.sensor_view) == len(inside)
+    assert all(any(so.body is b for so in b1.sensor_view) for b in inside)
+
+
 def test_passive_radar(shyphe):
     b1 = shyphe.Body(position=(0, 0))
     b1.add_sensor(shyphe.PassiveRadar(sensitivity=1))
@@ -197,3 +223,29 @@ def test_tracking(shyphe):
     assert sr.position.as_tuple() == (30, -60)
     assert sr.velocity.as_tuple() == (55, -60)
     assert sr.body == b
+
+
+def sensor_views(shyphe, threads):
+    w = shyphe.World(1)
+    w.threads = threads
+    bodies = []
+    for i in range(30):
+        b = shyphe.Body(position=(i % 6 * 20, i // 6 * 20), velocity=(i % 4, i % 3), side=i % 3)
+        b.add_sensor(shyphe.ActiveRadar(power=50, sensitivity=1))
+        b.add_shape(shyphe.MassShape(radar_cross_section=10 + i, mass=1))
+        w.add_body(b)
+        bodies.append(b)
+
+    views = []
+    for _ in range(3):
+        w.begin_frame()
+        w.end_frame()
+        views.append([[(bodies.index(so.body), so.position.as_tuple(), so.velocity.as_tuple(),
+                        so.signature.as_tuple(), so.side) for so in b.sensor_view] for b in bodies])
+    return views
+
+
+def test_threaded_sensor_views(shyphe):
+    serial = sensor_views(shyphe, 1)
+    assert any(serial[0])
+    assert sensor_views(shyphe, 4) == serial
@@ -203,3 +203,14 @@ def test_rotate(shyphe):
     assert shyphe.Vec(2, 1).rotate(-math.pi / 2).as_tuple() == pytest.approx((-1, 2))
     assert shyphe.Vec(0, 1).rotate(math.pi / 4).as_tuple() == pytest.approx((2 ** -0.5, 2 ** -0.5))
     assert shyphe.Vec(1, 1).rotate(math.pi / 4).as_tuple() == pytest.approx((2 ** 0.5, 0))
+
+
+def test_rot(shyphe):
+    rot = shyphe.Rot(math.pi / 2)
+    assert (rot.c, rot.s) == pytest.approx((0, 1))
+    assert rot.angle() == pytest.approx(math.pi / 2)
+    assert shyphe.Vec(2, 1).rotate(rot).as_tuple() == shyphe.Vec(2, 1).rotate(math.pi / 2).as_tuple()
+    assert rot.inverse().angle() == pytest.approx(-math.pi / 2)
+    assert (rot * shyphe.Rot(math.pi / 4)).angle() == pytest.approx(3 * math.pi / 4)
+    assert (rot * rot.inverse()).angle() == pytest.approx(0)
+    assert shyphe.Vec(0, 1).rotate(shyphe.Rot(1, 0)).as_tuple() == (0, 1)